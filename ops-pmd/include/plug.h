@@ -50,8 +50,8 @@ typedef struct pm_date_code {
         unsigned char   lot_code[2];    // Vendor Specific Lot Code (in ASCII)
 } pm_date_code_t;
 
-// OPS_TODO: USING BIT MAP DATA STRUCTURES IS NOT PORTABLE
-// OPS_TODO: CHANGE THIS IMPLEMENTATION TO USE #define VALUES
+// The bit fields below only describe the layout of the pages; bit field
+// order is up to the compiler, so bits are read through pm_sff.h.
 
 //
 //
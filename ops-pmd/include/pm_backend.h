@@ -0,0 +1,139 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for pluggable module hardware access backends.
+ *
+ * All access to module signals and EEPROMs goes through the backend
+ * selected with --backend=NAME[:ARG], so the same daemon code runs
+ * against real hardware, the simulator or EEPROM images on disk.
+ ***************************************************************************/
+
+#ifndef _PM_BACKEND_H_
+#define _PM_BACKEND_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "pmd.h"
+
+// EEPROM address spaces of a module. SFP diagnostics live at a separate
+// address; QSFP diagnostics are in the lower page of the A0 space.
+enum pm_eeprom {
+    PM_EEPROM_A0,                       // 0x50
+    PM_EEPROM_A2,                       // 0x51, SFP only
+};
+
+// Size of each EEPROM address space, and of a page. Offsets from
+// PM_EEPROM_PAGE_SIZE up are in the upper page given along with them.
+#define PM_EEPROM_SPACE_SIZE    256
+#define PM_EEPROM_PAGE_SIZE     128
+
+// One read of a batch
+struct pm_backend_req {
+    pm_port_t       *port;
+    enum pm_eeprom  eeprom;
+    uint8_t         page;
+    size_t          offset;
+    size_t          len;
+    unsigned char   *data;
+    int             rc;
+};
+
+//
+// Backend operations. All return 0 on success and non-zero on failure.
+//
+//   init:          called once at startup with the text after ':' in
+//                  --backend (NULL if none); optional
+//   port_destroy:  release per-port backend state; optional
+//   presence:      report whether a module is inserted
+//   read/write:    transfer len bytes at offset of an EEPROM space. The
+//                  page only matters to paged backends; the others
+//                  show whatever page the module has selected.
+//   reset:         assert or release module reset (QSFP)
+//   tx_disable:    set the transmitter disable mask; bit 0 for SFPs,
+//                  bits 0-3 for QSFP lanes
+//   presence_batch, read_batch:
+//                  presence checks and reads of many ports at once, so a
+//                  backend can overlap them; optional. Results are left
+//                  in present[]/rc[] and in each request's rc.
+//   sweep_end:     called after every sweep, e.g. to return shared
+//                  hardware to its idle state; optional
+//   paged:         tell whether the backend reaches a port's upper pages
+//                  by page number itself (as optoe does), in which case
+//                  no page select may be written; optional, false if NULL
+//
+struct pm_backend_class {
+    const char  *name;
+    const char  *arg_usage;             // shown by --help, NULL if no ARG
+
+    int  (*init)(const char *arg);
+    void (*port_destroy)(pm_port_t *port);
+
+    int  (*presence)(pm_port_t *port, bool *present);
+    int  (*read)(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+                 size_t offset, size_t len, unsigned char *data);
+    int  (*write)(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+                  size_t offset, size_t len, const unsigned char *data);
+    int  (*reset)(pm_port_t *port, bool asserted);
+    int  (*tx_disable)(pm_port_t *port, uint8_t mask);
+
+    void (*presence_batch)(pm_port_t *ports[], size_t n, bool present[],
+                           int rc[]);
+    void (*read_batch)(struct pm_backend_req *reqs, size_t n);
+    void (*sweep_end)(void);
+    bool (*paged)(const pm_port_t *port);
+};
+
+extern const struct pm_backend_class pm_backend_i2c;
+extern const struct pm_backend_class pm_backend_sim;
+extern const struct pm_backend_class pm_backend_file;
+extern const struct pm_backend_class pm_backend_sysfs;
+extern const struct pm_backend_class pm_backend_cpld;
+
+extern int pm_backend_select(const char *spec);
+extern void pm_backend_init(void);
+extern void pm_backend_usage(void);
+extern const char *pm_backend_name(void);
+extern off_t pm_backend_image_offset(const pm_port_t *port, size_t size,
+                                     enum pm_eeprom eeprom, uint8_t page,
+                                     size_t offset, size_t len);
+
+extern pm_bus_t *pm_backend_port_bus(pm_port_t *port);
+extern void pm_backend_port_destroy(pm_port_t *port);
+extern int pm_backend_presence(pm_port_t *port, bool *present);
+extern int pm_backend_read(pm_port_t *port, enum pm_eeprom eeprom,
+                           uint8_t page, size_t offset, size_t len,
+                           unsigned char *data);
+extern int pm_backend_write(pm_port_t *port, enum pm_eeprom eeprom,
+                            uint8_t page, size_t offset, size_t len,
+                            const unsigned char *data);
+extern int pm_backend_reset(pm_port_t *port, bool asserted);
+extern int pm_backend_tx_disable(pm_port_t *port, uint8_t mask);
+extern void pm_backend_sweep_end(void);
+extern bool pm_backend_batched(void);
+extern bool pm_backend_paged(const pm_port_t *port);
+extern void pm_backend_presence_batch(pm_port_t *ports[], size_t n,
+                                      bool present[], int rc[]);
+extern void pm_backend_read_batch(struct pm_backend_req *reqs, size_t n);
+
+#endif
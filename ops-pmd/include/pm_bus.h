@@ -0,0 +1,163 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for pluggable module I2C bus accounting.
+ ***************************************************************************/
+
+#ifndef _PM_BUS_H_
+#define _PM_BUS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <dynamic-string.h>
+
+#include "config-yaml.h"
+
+// Number of sweeps kept in each bus's occupancy time series
+#define PM_BUS_HISTORY_SIZE     120
+
+// Classes of bus operations, highest priority first. Identification and
+// telemetry share a token bucket per bus (see pm_bus_admit).
+enum pm_op_class {
+    PM_OP_CONTROL,                      // tx disable, reset
+    PM_OP_PRESENCE,
+    PM_OP_IDENTIFY,                     // serial ID reads
+    PM_OP_TELEMETRY,                    // DOM polling
+    PM_OP_N_CLASSES
+};
+
+// Default share of bus time for the budgeted classes, in percent
+#define PM_BUS_BUDGET_DEFAULT   50
+
+// Bus time a full token bucket holds at a 100% budget, in usecs
+#define PM_BUS_BUCKET_USEC      1000000
+
+// Longest wait for another process's bus lock, in msecs
+#define PM_BUS_LOCK_TIMEOUT     200
+
+// Default deadline of one EEPROM operation, in msecs (see --op-deadline)
+#define PM_BUS_DEADLINE_DEFAULT 100
+#define PM_BUS_DEADLINE_MAX     10000
+
+// Consecutive late operations after which a bus is declared hung
+#define PM_BUS_HUNG_THRESHOLD   3
+
+// Quarantine of a hung bus, in msecs; doubles while it keeps hanging
+#define PM_BUS_QUARANTINE_MIN   2000
+#define PM_BUS_QUARANTINE_MAX   60000
+
+// Bus usage during one sweep
+typedef struct {
+    long long int   time;               // wall clock at end of sweep, msecs
+    uint32_t        busy_usec;          // time spent in bus transactions
+    uint32_t        bytes;              // bytes transferred
+    uint32_t        transactions;
+    uint32_t        mux_switches;       // changes of the selected mux leg
+    uint32_t        mux_ops;            // mux select/deselect writes done
+    uint32_t        mux_ops_saved;      // skipped thanks to the mux shadow
+    uint32_t        class_usec[PM_OP_N_CLASSES]; // busy_usec by class
+    uint32_t        deferred;           // operations over budget
+    uint32_t        lock_wait_usec;     // waiting for other processes
+    uint32_t        lock_hold_usec;     // holding the bus lock
+    uint32_t        late;               // operations over the deadline
+} pm_bus_sample_t;
+
+typedef struct pm_bus {
+    char            *name;              // 'bus' name from devices.yaml
+
+    pm_bus_sample_t current;            // usage of the sweep in progress
+    char            *mux_path;          // mux leg last selected, or NULL
+
+    // mux shadow: the device whose pre operations are in effect on the
+    // bus and whose post operations have not been run yet; NULL if the
+    // muxes are deselected or in an unknown state
+    const YamlDevice *mux_owner;
+    char            *mux_subsystem;     // subsystem of mux_owner
+
+    // token bucket of the budgeted classes, in usecs of bus time; may go
+    // negative since an admitted operation is charged once it is done
+    long long int   tokens;
+    long long int   refill_time;        // pm_bus_usec() of the last refill
+
+    // cross-process bus lock (see pm_bus_lock)
+    bool            lock_tried;         // lock file open attempted
+    int             lock_fd;            // -1 if unavailable
+    unsigned int    lock_depth;         // nested holders in pmd
+    long long int   lock_since;         // pm_bus_usec() when acquired
+    unsigned long long lock_acquires;
+    unsigned long long lock_contended;  // acquires that had to wait
+    unsigned long long lock_timeouts;
+    long long int   lock_wait_max;      // usecs
+    long long int   lock_hold_max;      // usecs
+
+    // hung bus detection (see pm_bus_complete)
+    long long int   op_usec;            // transfer time of the operation
+                                        // in progress, -1 if not reported
+    bool            op_lock_failed;     // it could not take the bus lock
+    unsigned int    late;               // consecutive late operations
+    char            *offender;          // port of the last late operation
+    bool            hung;               // recovery pending
+    bool            probing;            // back from quarantine, on trial
+    long long int   quarantine_until;   // time_msec(); 0 if in service
+    long long int   quarantine_msec;    // length of the next quarantine
+    unsigned long long hangs;
+    unsigned long long recoveries;
+    unsigned long long skipped;         // operations refused in quarantine
+
+    pm_bus_sample_t history[PM_BUS_HISTORY_SIZE];
+    size_t          head;               // next slot to write
+    size_t          count;              // valid samples
+} pm_bus_t;
+
+extern pm_bus_t *pm_bus_get(const char *name);
+extern long long int pm_bus_usec(void);
+extern void pm_bus_account(pm_bus_t *bus, size_t bytes,
+                           long long int start_usec);
+extern void pm_bus_charge(pm_bus_t *bus, size_t bytes, long long int usec);
+extern char *pm_bus_mux_path(const YamlDevice *device);
+extern void pm_bus_select(pm_bus_t *bus, const char *mux_path);
+extern void pm_bus_plan(unsigned int unordered, unsigned int ordered);
+extern void pm_bus_set_mux_owner(pm_bus_t *bus, const YamlDevice *device,
+                                 const char *subsystem);
+extern void pm_bus_invalidate(pm_bus_t *bus);
+extern void pm_bus_for_each(void (*cb)(pm_bus_t *bus));
+extern unsigned int pm_bus_budget;
+extern void pm_bus_set_class(enum pm_op_class cls);
+extern bool pm_bus_has_budget(pm_bus_t *bus, enum pm_op_class cls);
+extern bool pm_bus_admit(pm_bus_t *bus, enum pm_op_class cls);
+extern char *pm_bus_lock_dir;
+extern int pm_bus_lock(pm_bus_t *bus);
+extern void pm_bus_unlock(pm_bus_t *bus);
+extern unsigned int pm_bus_deadline;
+extern bool pm_bus_quarantined(const pm_bus_t *bus);
+extern bool pm_bus_usable(pm_bus_t *bus);
+extern void pm_bus_op_begin(pm_bus_t *bus);
+extern void pm_bus_transferred(pm_bus_t *bus, long long int start_usec);
+extern long long int pm_bus_op_usec(const pm_bus_t *bus,
+                                    long long int start_usec);
+extern void pm_bus_complete(pm_bus_t *bus, const char *instance,
+                            long long int usec, int rc);
+extern void pm_bus_recovered(pm_bus_t *bus);
+extern void pm_bus_sweep_end(void);
+extern void pm_bus_dump(struct ds *ds);
+
+#endif
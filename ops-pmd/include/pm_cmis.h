@@ -0,0 +1,185 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for modules with a CMIS memory map (QSFP-DD, OSFP).
+ *
+ * The lower page (bytes 0-127) is always accessible. Bytes 128-255 show
+ * the upper page selected by writing the bank and page select bytes of
+ * the lower page, so every access to an upper page may need a write
+ * first. The port remembers the page it last selected, to skip writes
+ * that would not change it.
+ ***************************************************************************/
+
+#ifndef _PM_CMIS_H_
+#define _PM_CMIS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <dynamic-string.h>
+
+#include "pmd.h"
+#include "plug.h"
+
+// Identifiers (SFF-8024) of the CMIS form factors
+#define PM_CMIS_ID_QSFP_DD              0x18
+#define PM_CMIS_ID_OSFP                 0x19
+
+// Media interface technologies (upper page 00h byte 212)
+#define PM_CMIS_MEDIA_TECH_850NM_VCSEL  0x00
+#define PM_CMIS_MEDIA_TECH_COPPER_ACTIVE 0x0c   // and above: active cables
+
+#define PM_CMIS_PAGE_SIZE               128
+#define PM_CMIS_UPPER_OFFSET            128     // upper pages start here
+#define PM_CMIS_LANES                   8
+
+//
+//
+//      Lower page
+//
+//
+#define PM_CMIS_STATUS                  2       // bit 7: flat memory
+#define PM_CMIS_FLAT_MEMORY             0x80
+#define PM_CMIS_MODULE_FLAGS            9       // temperature and vcc flags
+#define PM_CMIS_TEMPERATURE             14
+#define PM_CMIS_VCC                     16
+#define PM_CMIS_BANK_SELECT             126
+#define PM_CMIS_PAGE_SELECT             127
+
+//
+//
+//      Upper page 00h: serial ID
+//
+//
+typedef struct {
+        unsigned char   identifier;             // byte 128
+        unsigned char   vendor_name[PM_VENDOR_NAME_LEN];
+        unsigned char   vendor_oui[PM_VENDOR_OUI_LEN];
+        unsigned char   vendor_part_number[PM_VENDOR_PN_LEN];
+        unsigned char   vendor_revision[PM_QSFP_VENDOR_REV_LEN];
+        unsigned char   vendor_serial_number[PM_VENDOR_SN_LEN];
+        pm_date_code_t  date_code;
+        unsigned char   clei_code[10];
+        unsigned char   power_class;            // byte 200
+        unsigned char   max_power;              // in 0.25 W
+        unsigned char   cable_length;           // bits 0-5 length,
+                                                // 6-7 multiplier
+        unsigned char   connector;              // byte 203
+        unsigned char   copper_attenuation[6];
+        unsigned char   media_lane_info;
+        unsigned char   cable_lane_info;
+        unsigned char   media_interface_technology; // byte 212
+        unsigned char   reserved_213[8];
+        unsigned char   custom_221;
+        unsigned char   checksum;               // of bytes 128-221
+        unsigned char   custom_info[33];
+} pm_cmis_serial_id_t;
+
+// cable assembly length: the length field times 0.1, 1, 10 or 100 m
+#define PM_CMIS_CABLE_LENGTH(byte)      ((byte) & 0x3f)
+#define PM_CMIS_CABLE_MULTIPLIER(byte)  (((byte) >> 6) & 0x3)
+
+//
+//
+//      Upper pages
+//
+//
+#define PM_CMIS_ADVERTISING             0x01
+#define PM_CMIS_THRESHOLDS              0x02
+#define PM_CMIS_LANE_CONTROL            0x10
+#define PM_CMIS_LANE_STATUS             0x11
+
+// page 01h: advertising
+#define PM_CMIS_LANE_MONITORS           160     // bits 0-2: tx bias, tx power,
+                                                // rx power implemented;
+                                                // 3-4: tx bias multiplier
+#define PM_CMIS_LANE_MONITORS_MASK      0x07
+
+// page 02h: thresholds, high alarm, low alarm, high warning, low warning
+#define PM_CMIS_TEMPERATURE_THRESHOLDS  128
+#define PM_CMIS_VCC_THRESHOLDS          136
+
+// page 10h: lane control
+#define PM_CMIS_TX_DISABLE              130     // bit per lane
+
+// page 11h: lane flags (one byte per flag, one bit per lane) and lane
+// monitors (two bytes per lane)
+#define PM_CMIS_LANE_FLAGS              135
+#define PM_CMIS_LANE_FLAGS_LEN          18
+#define PM_CMIS_TX_POWER                154
+#define PM_CMIS_TX_BIAS                 170
+#define PM_CMIS_RX_POWER                186
+#define PM_CMIS_LANE_MONITOR_LEN        (2 * PM_CMIS_LANES)
+
+// Interval between reads of upper pages that are still missing, in msecs;
+// it doubles after each attempt
+#define PM_CMIS_RETRY_MIN               1000
+#define PM_CMIS_RETRY_MAX               (5 * 60 * 1000)
+
+// Upper pages kept per port (see pm_cmis_pages)
+enum pm_cmis_page {
+    PM_CMIS_PAGE_ADVERTISING,
+    PM_CMIS_PAGE_THRESHOLDS,
+    PM_CMIS_PAGE_LANES,
+    PM_CMIS_N_PAGES
+};
+
+// byte at a module address of an upper page image
+#define PM_CMIS_UPPER(image, offset)    ((image)[(offset) - PM_CMIS_UPPER_OFFSET])
+
+// Per-port state of a CMIS cage
+typedef struct pm_cmis {
+    bool            selected;           // bank and page below are in effect
+    uint8_t         bank;
+    uint8_t         page;
+    bool            flat;               // module has upper page 00h only
+    unsigned int    loaded;             // bit per page read since insertion
+    long long int   retry_due;          // next read of missing pages
+    unsigned int    retry_interval;     // msecs, doubles while they fail
+    unsigned char   pages[PM_CMIS_N_PAGES][PM_CMIS_PAGE_SIZE];
+    unsigned long long int n_selects;   // page select writes
+    unsigned long long int n_skipped;   // page selects that were in effect
+} pm_cmis_t;
+
+extern bool pm_cmis_port(const pm_port_t *port);
+extern void pm_cmis_init(pm_port_t *port);
+extern void pm_cmis_destroy(pm_port_t *port);
+extern void pm_cmis_forget(pm_port_t *port);
+extern bool pm_cmis_selected(const pm_port_t *port, uint8_t bank,
+                             uint8_t page);
+extern int pm_cmis_read(pm_port_t *port, uint8_t bank, uint8_t page,
+                        size_t offset, size_t len, unsigned char *data);
+extern int pm_cmis_write(pm_port_t *port, uint8_t bank, uint8_t page,
+                         size_t offset, size_t len, const unsigned char *data);
+extern int pm_cmis_tx_disable(pm_port_t *port, uint8_t mask);
+
+extern void pm_cmis_reset(pm_port_t *port);
+extern size_t pm_cmis_plan_pages(pm_port_t *port, long long int now,
+                                 pm_dom_read_t reads[]);
+extern bool pm_cmis_lanes_monitored(const pm_port_t *port);
+extern unsigned char *pm_cmis_buffer(pm_port_t *port,
+                                     const pm_dom_read_t *read);
+extern int pm_cmis_read_dom(pm_port_t *port, const pm_dom_read_t *read);
+extern void pm_cmis_loaded(pm_port_t *port, const pm_dom_read_t *read);
+extern void pm_cmis_set_dom(pm_port_t *port, pm_dom_sample_t *sample);
+extern void pm_cmis_dump(struct ds *ds, const pm_port_t *port);
+
+#endif
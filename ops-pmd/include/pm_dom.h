@@ -24,6 +24,13 @@
 #ifndef _DOM_H_
 #define _DOM_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <smap.h>
+
+#include "pm_sff.h"
 
 #define PASSWORD_LEN                4
 
@@ -387,7 +394,7 @@ typedef struct {
 
 // QSFP Channel Monitors
 typedef struct {
-    // bytes 34 to 49
+    // bytes 34 to 81
     unsigned char rx1_power_msb;
     unsigned char rx1_power_lsb;
 
@@ -412,14 +419,18 @@ typedef struct {
     unsigned char tx4_bias_msb;
     unsigned char tx4_bias_lsb;
 
-    unsigned char reserved_50;
-    unsigned char reserved_51;
-    unsigned char reserved_52;
-    unsigned char reserved_53;
-    unsigned char reserved_54;
-    unsigned char reserved_55;
-    unsigned char reserved_56;
-    unsigned char reserved_57;
+    // bytes 50 to 57, if advertised in byte 220
+    unsigned char tx1_power_msb;
+    unsigned char tx1_power_lsb;
+
+    unsigned char tx2_power_msb;
+    unsigned char tx2_power_lsb;
+
+    unsigned char tx3_power_msb;
+    unsigned char tx3_power_lsb;
+
+    unsigned char tx4_power_msb;
+    unsigned char tx4_power_lsb;
 
     unsigned char reserved_58;
     unsigned char reserved_59;
@@ -720,4 +731,167 @@ struct ovs_module_dom_info {
     char *rx4_power_low_warning_threshold;
 };
 
+// A DOM flag column and the bit of the DOM page it is set from; tables of
+// them are expanded from the PM_*_DOM_FLAGS lists of pm_sff.h
+typedef struct {
+    size_t          column;             // in struct ovs_module_dom_info
+    pm_sff_bit_t    bit;
+} pm_dom_flag_t;
+
+#define PM_DOM_FLAG(column, offset, bit) \
+    { offsetof(struct ovs_module_dom_info, column), PM_SFF_BIT(offset, bit) },
+
+//
+//
+//      DOM polling
+//
+//
+
+// Size of the DOM page: A2h lower page for SFPs, lower page for QSFPs
+#define PM_DOM_PAGE_SIZE                128
+
+// DOM quantities, each polled on its own interval
+enum pm_dom_quantity {
+    PM_DOM_Q_TEMPERATURE,
+    PM_DOM_Q_VCC,
+    PM_DOM_Q_TX_BIAS,
+    PM_DOM_Q_TX_POWER,
+    PM_DOM_Q_RX_POWER,
+    PM_DOM_Q_FLAGS,
+    PM_DOM_N_QUANTITIES
+};
+
+// Upper pages a poll may read in full (see pm_cmis_pages)
+#define PM_DOM_MAX_PAGE_READS           3
+
+// Most ranges a poll reads: one per quantity and the upper pages
+#define PM_DOM_MAX_READS        (PM_DOM_N_QUANTITIES + PM_DOM_MAX_PAGE_READS)
+
+// A byte range of the DOM page that is due to be read. CMIS modules
+// spread their DOM over the lower page and upper pages; bank and page
+// select the upper page of a range at offset 128 or above.
+typedef struct {
+    size_t          offset;
+    size_t          len;
+    uint8_t         bank;
+    uint8_t         page;
+} pm_dom_read_t;
+
+// Bytes 0-39 of the SFP A2h page hold the alarm and warning thresholds
+#define PM_SFP_DOM_THRESHOLDS_LEN      40
+
+// External calibration constants of an SFP (SFF-8472 A2h bytes 56-91),
+// decoded once per insertion. Slopes are unsigned 8.8 fixed point and
+// offsets are in the units of the calibrated value.
+typedef struct {
+    bool            external;                   // module needs calibrating
+    bool            loaded;                     // constants decoded
+    float           rx_pwr[5];                  // Rx_PWR(0) .. Rx_PWR(4)
+    float           tx_i_slope;
+    float           tx_i_offset;
+    float           tx_pwr_slope;
+    float           tx_pwr_offset;
+    float           t_slope;
+    float           t_offset;
+    float           v_slope;
+    float           v_offset;
+    unsigned char   thresholds[PM_SFP_DOM_THRESHOLDS_LEN]; // calibrated
+} pm_dom_calibration_t;
+
+// Per-port DOM polling state
+typedef struct {
+    unsigned char   page[PM_DOM_PAGE_SIZE];     // last image of the DOM page
+    bool            valid;                      // page has been read in full
+    bool            scheduled;                  // full read has a slot
+    long long int   full_due;                   // slot of the full read
+    long long int   next_due[PM_DOM_N_QUANTITIES]; // monotonic, in msecs
+    unsigned int    jitter[PM_DOM_N_QUANTITIES];   // added to next_due
+    pm_dom_calibration_t cal;
+} pm_dom_state_t;
+
+// Upper bound for --dom-jitter, in msecs
+#define PM_DOM_JITTER_MAX       1000
+
+//
+//
+//      DOM history
+//
+//
+
+#define PM_DOM_MAX_LANES                8
+
+// Default and maximum number of samples kept per port
+#define PM_DOM_HISTORY_DEFAULT_SIZE     64
+#define PM_DOM_HISTORY_MAX_SIZE         4096
+
+// combine the msb/lsb pair of a monitor value into its raw 16-bit form
+#define PM_DOM_RAW16(msb, lsb) \
+    ((uint16_t)(((unsigned char)(msb) << 8) | (unsigned char)(lsb)))
+
+// Units of the raw monitor values (SFF-8472, SFF-8636 and CMIS)
+#define PM_DOM_TEMPERATURE_UNIT         (1.0 / 256)     // degrees C
+#define PM_DOM_VCC_UNIT                 0.0001          // V
+#define PM_DOM_BIAS_UNIT                0.002           // mA
+#define PM_DOM_POWER_UNIT               0.0001          // mW
+
+// One DOM sample, kept in the raw fixed-point units read from the module
+typedef struct {
+    long long int   time;                       // wall clock, in msecs
+    int16_t         temperature;
+    uint16_t        vcc;
+    uint16_t        tx_bias[PM_DOM_MAX_LANES];
+    uint16_t        tx_power[PM_DOM_MAX_LANES];
+    uint16_t        rx_power[PM_DOM_MAX_LANES];
+    uint8_t         n_lanes;
+    bool            has_tx_power;               // tx_power[] is measured
+} pm_dom_sample_t;
+
+// Fixed-size ring of DOM samples, allocated once per port
+typedef struct {
+    pm_dom_sample_t *samples;
+    size_t          size;                       // capacity, in samples
+    size_t          head;                       // next slot to write
+    size_t          count;                      // valid samples
+} pm_dom_history_t;
+
+//
+//
+//      DOM aggregates
+//
+//
+
+// Aggregation windows, aligned to the wall clock like PM bins
+enum pm_dom_window {
+    PM_DOM_WINDOW_1M,
+    PM_DOM_WINDOW_15M,
+    PM_DOM_N_WINDOWS
+};
+
+// Fractional bits kept in the EWMA, which is stored in raw units
+#define PM_DOM_EWMA_FRACTION_BITS       8
+
+// Aggregate of one quantity over the current window, in raw units
+typedef struct {
+    int32_t         min;
+    int32_t         max;
+    int64_t         sum;
+    uint32_t        count;                      // samples in this window
+    int32_t         ewma;                       // carried across windows
+    bool            ewma_valid;
+} pm_dom_agg_t;
+
+typedef struct {
+    long long int   bin;                        // index of the open bin
+    long long int   last_time;                  // of the last sample
+    pm_dom_agg_t    temperature;
+    pm_dom_agg_t    tx_power[PM_DOM_MAX_LANES];
+    pm_dom_agg_t    rx_power[PM_DOM_MAX_LANES];
+} pm_dom_window_t;
+
+// Per-port aggregates and the values published at the last window close
+typedef struct {
+    pm_dom_window_t windows[PM_DOM_N_WINDOWS];
+    struct smap     published;
+} pm_dom_stats_t;
+
 #endif
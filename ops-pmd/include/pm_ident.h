@@ -0,0 +1,40 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for the cache of decoded module identities.
+ ***************************************************************************/
+
+#ifndef _PM_IDENT_H_
+#define _PM_IDENT_H_
+
+#include <stdbool.h>
+
+#include <dynamic-string.h>
+
+#include "pmd.h"
+
+// Distinct serial IDs remembered; the least recently used one goes first
+#define PM_IDENT_CACHE_SIZE     64
+
+extern bool pm_ident_lookup(pm_port_t *port, const unsigned char *a0);
+extern void pm_ident_store(const pm_port_t *port, const unsigned char *a0);
+extern void pm_ident_dump(struct ds *ds);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for batched EEPROM file I/O.
+ ***************************************************************************/
+
+#ifndef _PM_IO_H_
+#define _PM_IO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <dynamic-string.h>
+
+// One pread/pwrite of a batch
+struct pm_io {
+    int             fd;
+    void            *buf;
+    size_t          len;
+    off_t           pos;
+    bool            write;
+    ssize_t         res;                // bytes transferred or -errno
+};
+
+// Upper bound for --io-latency, in usecs
+#define PM_IO_LATENCY_MAX       1000000
+
+extern unsigned int pm_io_latency;
+extern int pm_io_set_mode(const char *mode);
+extern void pm_io_submit(struct pm_io *ios, size_t n);
+extern void pm_io_dump(struct ds *ds);
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for pluggable module access retries and circuit breakers.
+ ***************************************************************************/
+
+#ifndef _PM_RETRY_H_
+#define _PM_RETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <dynamic-string.h>
+
+// How an access is retried within a sweep
+typedef struct {
+    unsigned int    attempts;           // tries, including the first
+    unsigned int    backoff_usec;       // pause before the first retry,
+                                        // doubled before each further one
+} pm_retry_policy_t;
+
+extern const pm_retry_policy_t pm_retry_presence;
+extern const pm_retry_policy_t pm_retry_eeprom;
+extern const pm_retry_policy_t pm_retry_checksum;
+
+extern bool pm_retry_again(const pm_retry_policy_t *policy,
+                           unsigned int *attempt);
+
+// Consecutive failed sweeps after which a port is parked
+#define PM_BREAKER_THRESHOLD        3
+
+// Bounds of the probe interval of a parked port, in msecs
+#define PM_BREAKER_PROBE_MIN        2000
+#define PM_BREAKER_PROBE_MAX        300000
+
+enum pm_breaker_state {
+    PM_BREAKER_CLOSED,                  // module accessed every sweep
+    PM_BREAKER_OPEN,                    // parked until next_probe
+    PM_BREAKER_HALF_OPEN,               // probing; one failure reparks
+};
+
+// Per-port circuit breaker over the module's EEPROM accesses
+typedef struct {
+    enum pm_breaker_state state;
+    unsigned int    failures;           // consecutive failed sweeps
+    unsigned int    trips;              // times parked
+    unsigned long long skipped;         // sweeps skipped while parked
+    long long int   probe_interval;     // msecs
+    long long int   next_probe;         // monotonic, in msecs
+    bool            present;            // last presence seen
+} pm_breaker_t;
+
+extern void pm_breaker_reset(pm_breaker_t *breaker);
+extern void pm_breaker_presence(pm_breaker_t *breaker, bool present);
+extern bool pm_breaker_due(const pm_breaker_t *breaker, long long int now);
+extern bool pm_breaker_allow(pm_breaker_t *breaker, long long int now);
+extern void pm_breaker_success(pm_breaker_t *breaker, const char *instance);
+extern void pm_breaker_failure(pm_breaker_t *breaker, const char *instance,
+                               long long int now);
+extern void pm_breaker_dump(struct ds *ds, const pm_breaker_t *breaker,
+                            long long int now);
+
+#endif
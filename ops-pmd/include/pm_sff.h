@@ -0,0 +1,171 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for the bits of SFF EEPROM pages, as byte offsets and masks.
+ *
+ * The order of C bit fields within a byte is up to the compiler, so the
+ * bit field structures of plug.h and pm_dom.h only describe where bytes
+ * are. Bits are decoded through the lists below instead, each entry
+ * X(name, offset, bit) giving a bit of the byte at an offset of a page.
+ * A list is expanded into named offsets and masks (PM_SFF_ENUM) or into
+ * a descriptor table, and its offsets are checked against the structures
+ * when the code using it is compiled.
+ ***************************************************************************/
+
+#ifndef _PM_SFF_H_
+#define _PM_SFF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A bit of a page, and whether it is set
+typedef struct {
+    uint8_t     offset;
+    uint8_t     mask;
+} pm_sff_bit_t;
+
+#define PM_SFF_BIT(offset, bit)         { (offset), 1u << (bit) }
+#define PM_SFF_IS_SET(page, desc) \
+    (0 != ((page)[(desc).offset] & (desc).mask))
+
+// name_OFFSET and name_MASK of each entry, and whether one is set
+#define PM_SFF_ENUM(name, offset, bit) \
+    name##_OFFSET = (offset), name##_MASK = 1u << (bit),
+#define PM_SFF_TEST(page, name) \
+    (0 != (((const unsigned char *)(page))[name##_OFFSET] & name##_MASK))
+
+// an entry lies in a structure member (of some bytes)
+#define PM_SFF_IN(type, member, offset) \
+    ((offset) >= offsetof(type, member) && \
+     (offset) < offsetof(type, member) + sizeof(((type *)0)->member))
+
+//
+//
+//      SFF-8472: SFP+ serial ID (A0h) and diagnostics (A2h)
+//
+//
+
+// serial ID bits, bytes 0-127 of A0h
+#define PM_SFP_ID_TRANSCEIVER           3       // bytes 3-10
+#define PM_SFP_ID_DIAG_MONITORING       92
+
+#define PM_SFP_ID_BITS(X) \
+    X(PM_SFP_CABLE_PASSIVE,             8, 2) \
+    X(PM_SFP_CABLE_ACTIVE,              8, 3) \
+    X(PM_SFP_DIAG_ADDR_CHANGE,          92, 2) \
+    X(PM_SFP_DIAG_AVERAGE_POWER,        92, 3) \
+    X(PM_SFP_DIAG_EXTERNAL,             92, 4) \
+    X(PM_SFP_DIAG_INTERNAL,             92, 5) \
+    X(PM_SFP_DIAG_IMPLEMENTED,          92, 6) \
+    X(PM_SFP_DIAG_LEGACY,               92, 7)
+
+enum { PM_SFP_ID_BITS(PM_SFF_ENUM) };
+
+// alarm and warning flags, bytes 112-119 of A2h, by DOM column
+#define PM_SFP_DOM_FLAGS_OFFSET         112
+#define PM_SFP_DOM_FLAGS_LEN            8
+
+#define PM_SFP_DOM_FLAGS(X) \
+    X(temperature_high_alarm,           112, 7) \
+    X(temperature_low_alarm,            112, 6) \
+    X(vcc_high_alarm,                   112, 5) \
+    X(vcc_low_alarm,                    112, 4) \
+    X(tx_bias_high_alarm,               112, 3) \
+    X(tx_bias_low_alarm,                112, 2) \
+    X(tx_power_high_alarm,              112, 1) \
+    X(tx_power_low_alarm,               112, 0) \
+    X(rx_power_high_alarm,              113, 7) \
+    X(rx_power_low_alarm,               113, 6) \
+    X(temperature_high_warning,         116, 7) \
+    X(temperature_low_warning,          116, 6) \
+    X(vcc_high_warning,                 116, 5) \
+    X(vcc_low_warning,                  116, 4) \
+    X(tx_bias_high_warning,             116, 3) \
+    X(tx_bias_low_warning,              116, 2) \
+    X(tx_power_high_warning,            116, 1) \
+    X(tx_power_low_warning,             116, 0) \
+    X(rx_power_high_warning,            117, 7) \
+    X(rx_power_low_warning,             117, 6)
+
+//
+//
+//      SFF-8636: QSFP lower page and upper page 00h
+//
+//
+
+// lower page bits
+#define PM_QSFP_LOWER_BITS(X) \
+    X(PM_QSFP_DATA_NOT_READY,           2, 0) \
+    X(PM_QSFP_FLAT_MEMORY,              2, 2)
+
+enum { PM_QSFP_LOWER_BITS(PM_SFF_ENUM) };
+
+// upper page 00h bits, at offsets from byte 128 like pm_qsfp_serial_id_t
+#define PM_QSFP_ID_OPTIONS              (195 - 128)
+#define PM_QSFP_ID_DIAG_MONITORING      (220 - 128)
+
+#define PM_QSFP_ID_BITS(X) \
+    X(PM_QSFP_PAGE_01H_PROVIDED,        PM_QSFP_ID_OPTIONS, 6) \
+    X(PM_QSFP_PAGE_02H_PROVIDED,        PM_QSFP_ID_OPTIONS, 7) \
+    X(PM_QSFP_DIAG_TX_POWER,            PM_QSFP_ID_DIAG_MONITORING, 2) \
+    X(PM_QSFP_DIAG_AVERAGE_POWER,       PM_QSFP_ID_DIAG_MONITORING, 3)
+
+enum { PM_QSFP_ID_BITS(PM_SFF_ENUM) };
+
+// latched lane flags, bytes 9-12 of the lower page, by DOM column. Each
+// byte holds two lanes, the lower numbered one in the upper nibble.
+#define PM_QSFP_DOM_FLAGS_OFFSET        9
+#define PM_QSFP_DOM_FLAGS_LEN           4
+
+#define PM_QSFP_LANE_FLAGS(X, lane, offset, shift) \
+    X(lane##_high_alarm,                offset, (shift) + 3) \
+    X(lane##_low_alarm,                 offset, (shift) + 2) \
+    X(lane##_high_warning,              offset, (shift) + 1) \
+    X(lane##_low_warning,               offset, (shift) + 0)
+
+#define PM_QSFP_DOM_FLAGS(X) \
+    PM_QSFP_LANE_FLAGS(X, rx1_power,    9, 4) \
+    PM_QSFP_LANE_FLAGS(X, rx2_power,    9, 0) \
+    PM_QSFP_LANE_FLAGS(X, rx3_power,    10, 4) \
+    PM_QSFP_LANE_FLAGS(X, rx4_power,    10, 0) \
+    PM_QSFP_LANE_FLAGS(X, tx1_bias,     11, 4) \
+    PM_QSFP_LANE_FLAGS(X, tx2_bias,     11, 0) \
+    PM_QSFP_LANE_FLAGS(X, tx3_bias,     12, 4) \
+    PM_QSFP_LANE_FLAGS(X, tx4_bias,     12, 0)
+
+//
+//
+//      CMIS: lower page
+//
+//
+
+// module flags, byte 9 of the lower page, by DOM column
+#define PM_CMIS_DOM_FLAGS(X) \
+    X(temperature_high_alarm,           9, 0) \
+    X(temperature_low_alarm,            9, 1) \
+    X(temperature_high_warning,         9, 2) \
+    X(temperature_low_warning,          9, 3) \
+    X(vcc_high_alarm,                   9, 4) \
+    X(vcc_low_alarm,                    9, 5) \
+    X(vcc_high_warning,                 9, 6) \
+    X(vcc_low_warning,                  9, 7)
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for the module identity snapshot kept across restarts.
+ ***************************************************************************/
+
+#ifndef _PM_SNAPSHOT_H_
+#define _PM_SNAPSHOT_H_
+
+#include <stdbool.h>
+
+#include <dynamic-string.h>
+
+#include "pmd.h"
+
+// File name in the OVS run directory unless --snapshot says otherwise
+#define PM_SNAPSHOT_NAME        "ops-pmd.snapshot"
+
+#define PM_SNAPSHOT_MAGIC       0x504d4453      // "PMDS"
+#define PM_SNAPSHOT_VERSION     1
+
+// Longest interface name a record holds, with its terminator
+#define PM_SNAPSHOT_INSTANCE_LEN 32
+#define PM_SNAPSHOT_FORM_LEN    16
+
+extern char *pm_snapshot_file;
+
+extern void pm_snapshot_load(void);
+extern bool pm_snapshot_take(const char *instance, const char *form,
+                             unsigned char *a0);
+extern void pm_snapshot_published(void);
+extern bool pm_snapshot_verifying(void);
+extern void pm_snapshot_verified(const char *instance, bool match);
+extern void pm_snapshot_changed(void);
+extern void pm_snapshot_save(void);
+extern void pm_snapshot_dump(struct ds *ds);
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Header file for the upper page cache of QSFP (SFF-8636) modules.
+ *
+ * Bytes 128-255 of a QSFP show the upper page selected by the page select
+ * byte of the lower page. Pages 00h-03h are kept per port and published
+ * in the a0_uppers column; CMIS modules keep their pages in pm_cmis.
+ ***************************************************************************/
+
+#ifndef _PM_UPPER_H_
+#define _PM_UPPER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <dynamic-string.h>
+
+#include "pmd.h"
+
+#define PM_UPPER_PAGE_SIZE              128
+#define PM_UPPER_OFFSET                 128     // upper pages start here
+#define PM_UPPER_N_PAGES                4       // pages 00h-03h
+
+// lower page; the flat memory bit is in pm_sff.h
+#define PM_UPPER_PAGE_SELECT            127
+
+// upper pages
+#define PM_UPPER_SERIAL_ID              0x00
+#define PM_UPPER_APPLICATIONS           0x01    // if advertised in byte 195
+#define PM_UPPER_USER_EEPROM            0x02    // if advertised in byte 195
+#define PM_UPPER_THRESHOLDS             0x03    // unless flat memory
+
+// Pages read once after insertion. The user EEPROM may be rewritten by
+// the host at any time, so it is only read when requested.
+#define PM_UPPER_STATIC         ((1u << PM_UPPER_SERIAL_ID) | \
+                                 (1u << PM_UPPER_APPLICATIONS) | \
+                                 (1u << PM_UPPER_THRESHOLDS))
+
+// Per-port upper page cache of a QSFP cage
+typedef struct pm_upper {
+    bool            selected;           // page below is in effect
+    uint8_t         page;
+    bool            probed;             // provided below is known
+    unsigned int    provided;           // bit per page the module has
+    unsigned int    loaded;             // bit per page read since insertion
+    unsigned int    requested;          // bit per page to read again
+    unsigned char   pages[PM_UPPER_N_PAGES][PM_UPPER_PAGE_SIZE];
+    unsigned long long int n_selects;   // page select writes
+    unsigned long long int n_skipped;   // page selects that were in effect
+} pm_upper_t;
+
+extern void pm_upper_init(pm_port_t *port);
+extern void pm_upper_destroy(pm_port_t *port);
+extern void pm_upper_forget(pm_port_t *port);
+extern void pm_upper_reset(pm_port_t *port);
+extern bool pm_upper_selected(const pm_port_t *port, uint8_t page);
+extern int pm_upper_read(pm_port_t *port, uint8_t page, size_t offset,
+                         size_t len, unsigned char *data);
+extern bool pm_upper_due(const pm_port_t *port);
+extern int pm_upper_refresh(pm_port_t *port);
+extern int pm_upper_request(struct ds *ds, const char *name,
+                            unsigned int page);
+extern void pm_upper_dump(struct ds *ds, const pm_port_t *port);
+
+#endif
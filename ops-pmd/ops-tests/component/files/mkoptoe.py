@@ -0,0 +1,84 @@
+#!/usr/bin/python
+#
+#  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+#
+#  Licensed under the Apache License, Version 2.0 (the "License"); you may
+#  not use this file except in compliance with the License. You may obtain
+#  a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#  Unless required by applicable law or agreed to in writing, software
+#  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#  License for the specific language governing permissions and limitations
+#  under the License.
+#
+# Build full EEPROM images in the optoe driver's layout from the serial ID
+# blocks in the *.bin files: mkoptoe.py SRCDIR DSTDIR
+#
+# SFP images are 512 bytes: A0h, then A2h. QSFP images are 640 bytes: the
+# lower page, then upper pages 00h-03h. Modules that advertise DOM get
+# nominal readings and thresholds; passive QSFP cables are flat memory.
+#
+import os, struct, sys
+src, dst = sys.argv[1], sys.argv[2]
+os.makedirs(dst, exist_ok=True)
+
+def w16(buf, off, *vals):
+    for i, v in enumerate(vals):
+        struct.pack_into('>H', buf, off + 2 * i, v & 0xffff)
+
+# alarm high, alarm low, warning high, warning low, in raw units
+TEMP = (75 * 256, (-5 * 256) & 0xffff, 70 * 256, 0)
+VCC = (36000, 30000, 35000, 31000)
+BIAS = (6000, 1000, 5500, 1500)
+TXPWR = (10000, 1000, 8000, 1500)
+RXPWR = (12500, 100, 10000, 200)
+
+# nominal readings
+T, V, I, P_TX, P_RX = 35 * 256 + 128, 33000, 3000, 5000, 4500
+
+def sfp(a0):
+    img = bytearray(512)
+    img[0:128] = a0
+    if a0[92] & 0x40:                       # DOM implemented
+        a2 = memoryview(img)[256:512]
+        w16(img, 256 + 0, *TEMP)
+        w16(img, 256 + 8, *VCC)
+        w16(img, 256 + 16, *BIAS)
+        w16(img, 256 + 24, *TXPWR)
+        w16(img, 256 + 32, *RXPWR)
+        img[256 + 95] = sum(img[256:256 + 95]) & 0xff
+        w16(img, 256 + 96, T, V, I, P_TX, P_RX)
+    return img
+
+def qsfp(page0):
+    img = bytearray(640)
+    img[0] = page0[0]                       # identifier
+    img[1] = 0x05                           # SFF-8636 revision 2.5
+    dom = page0[220 - 128] & 0x08
+    img[2] = 0x00 if dom else 0x04          # passive cables: flat memory
+    img[128:256] = page0
+    if dom:
+        w16(img, 22, T)
+        w16(img, 26, V)
+        w16(img, 34, *([P_RX] * 4))
+        w16(img, 42, *([I] * 4))
+        if page0[220 - 128] & 0x04:
+            w16(img, 50, *([P_TX] * 4))
+        p3 = 128 + 3 * 128                  # upper page 03h
+        w16(img, p3 + 0, *TEMP)
+        w16(img, p3 + 16, *VCC)
+        w16(img, p3 + 48, *RXPWR)
+        w16(img, p3 + 56, *BIAS)
+        w16(img, p3 + 64, *TXPWR)
+    return img
+
+for name in sorted(os.listdir(src)):
+    if not name.endswith('.bin'):
+        continue
+    data = open(os.path.join(src, name), 'rb').read()
+    img = sfp(data) if name.startswith('SFP') else qsfp(data)
+    open(os.path.join(dst, name), 'wb').write(img)
+    print(name, len(img))
@@ -19,9 +19,10 @@
 
 import time
 from pytest import fixture
-from os.path import dirname, isdir
+from os.path import dirname, isdir, join
 from os import chdir
 from json import loads
+from re import search
 from shutil import copy
 
 TOPOLOGY = """
@@ -37,6 +38,11 @@ TOPOLOGY = """
 test_file_dir = "/files"
 sfp_interface = "21"
 qsfp_interface = "49"
+# full eeprom images for the file backend, and where ops-pmd looks for them
+optoe_file_dir = "optoe"
+file_backend_dir = "/tmp/pmd-modules"
+# sample files whose modules have DOM
+dom_files = ["SFP_SR_AVAGO.bin", "QSFP_SR4_AVAGO.bin"]
 # sample files and expected results for SFPs
 sfp_files = {
     "SFP_DAC_MOLEX.bin": {
@@ -131,6 +137,41 @@ def remove_pluggable(interface, sw1):
     time.sleep(0.5)
 
 
+def start_file_backend(sw1):
+    sw1("systemctl stop ops-pmd", shell='bash')
+    sw1("rm -rf {0}; mkdir -p {0}".format(file_backend_dir), shell='bash')
+    sw1("ops-pmd --detach --pidfile --backend=file:{}"
+        "".format(file_backend_dir), shell='bash')
+    time.sleep(2)
+
+
+def stop_file_backend(sw1):
+    sw1("ovs-appctl -t ops-pmd exit", shell='bash')
+    sw1("rm -rf {}".format(file_backend_dir), shell='bash')
+    sw1("systemctl start ops-pmd", shell='bash')
+    time.sleep(2)
+
+
+def insert_module_file(interface, module, sw1):
+    # the image appears at once, so it is never read half copied
+    copy(join(optoe_file_dir, module), join(sw1.shared_dir, "optoe-" + module))
+    sw1("cp /tmp/optoe-{1} {0}/.{2} && mv {0}/.{2} {0}/{2}"
+        "".format(file_backend_dir, module, interface), shell='bash')
+    time.sleep(1)
+
+
+def remove_module_file(interface, sw1):
+    sw1("rm -f {}/{}".format(file_backend_dir, interface), shell='bash')
+    time.sleep(1)
+
+
+def get_dom_samples(interface, sw1):
+    out = sw1("ovs-appctl -t ops-pmd ops-pmd/dom-history {}"
+              "".format(interface), shell='bash')
+    match = search(r"\((\d+) of \d+ samples\)", out)
+    return int(match.group(1)) if match else 0
+
+
 def get_interface(interface, sw1):
     pm_info = dict()
     out = sw1("ovs-vsctl --columns=pm_info --format=json list interface {}"
@@ -174,6 +215,28 @@ def _test_insert_remove_module(interface, dataset, sw1):
         assert pm_info["connector_status"] == "unrecognized"
 
 
+def _test_file_backend_module(interface, dataset, sw1):
+    for module in dataset:
+        insert_module_file(interface, module, sw1)
+        pm_info = get_interface(interface, sw1)
+        reference_info = dataset[module]
+        for attribute in reference_info:
+            assert reference_info[attribute] == pm_info[attribute]
+        if module in dom_files:
+            # DOM polls must keep succeeding, or the port would be parked
+            time.sleep(3)
+            assert get_dom_samples(interface, sw1) > 0
+            pm_info = get_interface(interface, sw1)
+            for attribute in reference_info:
+                assert reference_info[attribute] == pm_info[attribute]
+        # nothing of the module, DOM included, is left once it is removed
+        remove_module_file(interface, sw1)
+        pm_info = get_interface(interface, sw1)
+        assert pm_info["connector"] == "absent"
+        assert pm_info["connector_status"] == "unrecognized"
+        assert len(pm_info) == 2
+
+
 def test_pmd(topology, step):
     sw1 = topology.get("sw1")
     step("1-Testing initial conditions\n")
@@ -196,3 +259,16 @@ def test_pmd(topology, step):
     _test_insert_remove_module(sfp_interface, sfp_files, sw1)
     step("3-Testing module insertion/removal of QSFP+s\n")
     _test_insert_remove_module(qsfp_interface, qsfp_files, sw1)
+
+
+def test_pmd_file_backend(topology, step):
+    sw1 = topology.get("sw1")
+    step("1-Restarting ops-pmd with the file backend\n")
+    start_file_backend(sw1)
+    try:
+        step("2-Testing SFP+ eeprom images\n")
+        _test_file_backend_module(sfp_interface, sfp_files, sw1)
+        step("3-Testing QSFP+ eeprom images\n")
+        _test_file_backend_module(qsfp_interface, qsfp_files, sw1)
+    finally:
+        stop_file_backend(sw1)
@@ -32,9 +32,16 @@
 #include <dynamic-string.h>
 #include <vswitch-idl.h>
 #include <openswitch-idl.h>
+#include <timeval.h>
 
 #include "pmd.h"
 #include "pm_dom.h"
+#include "pm_backend.h"
+#include "pm_ident.h"
+#include "pm_snapshot.h"
+#include "pm_io.h"
+#include "pm_cmis.h"
+#include "pm_upper.h"
 
 VLOG_DEFINE_THIS_MODULE(ovsdb_access);
 
@@ -105,6 +112,14 @@ ovsdb_if_intf_create(const struct ovsrec_interface *intf, const char *sub_name)
 
     port->retry = false;
 
+    pm_dom_history_init(port);
+    pm_dom_stats_init(port);
+    pm_cmis_init(port);
+    pm_upper_init(port);
+
+    // publish the module the port had before a restart right away
+    pm_restore_port(port);
+
     //将端口添加到os_intfs窗扇中，以实例为关键字
     shash_add(&ovs_intfs, port->instance, (void *)port);
 
@@ -204,6 +219,7 @@ pm_ovsdb_update(void)
     SHASH_FOR_EACH(node, &ovs_intfs) {
         struct ovs_module_info *module;
         struct ovs_module_dom_info *module_dom;
+        struct smap_node *dom_stat;
         struct smap pm_info;
 
         port = (pm_port_t *)node->data;
@@ -266,14 +282,16 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "vendor_serial_number",
                      module->vendor_serial_number);
         }*/
+        // QSFP upper pages read so far (see pm_upper)
+        if (module->a0_uppers) {
+            smap_add(&pm_info, "a0_uppers", module->a0_uppers);
+        }
 
 				
-        // Update diagnostics key values
+        // Update diagnostics key values: alarm and warning flags and
+        // thresholds. Readings change with every sample and are published
+        // only as window aggregates (see pm_dom_stats_update).
         module_dom = &port->ovs_module_dom_columns;
-/*
-        if (module_dom->temperature) {
-            smap_add(&pm_info, "temperature", module_dom->temperature);
-        }
         if (module_dom->temperature_high_alarm) {
             smap_add(&pm_info, "temperature_high_alarm", module_dom->temperature_high_alarm);
         }
@@ -299,9 +317,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "temperature_low_warning_threshold", module_dom->temperature_low_warning_threshold);
         }
 
-        if (module_dom->vcc) {
-            smap_add(&pm_info, "vcc", module_dom->vcc);
-        }
         if (module_dom->vcc_high_alarm) {
             smap_add(&pm_info, "vcc_high_alarm", module_dom->vcc_high_alarm);
         }
@@ -327,9 +342,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "vcc_low_warning_threshold", module_dom->vcc_low_warning_threshold);
         }
 
-        if (module_dom->tx_bias) {
-            smap_add(&pm_info, "tx_bias", module_dom->tx_bias);
-        }
         if (module_dom->tx_bias_high_alarm) {
             smap_add(&pm_info, "tx_bias_high_alarm", module_dom->tx_bias_high_alarm);
         }
@@ -355,9 +367,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "tx_bias_low_warning_threshold", module_dom->tx_bias_low_warning_threshold);
         }
 
-        if (module_dom->rx_power) {
-            smap_add(&pm_info, "rx_power", module_dom->rx_power);
-        }
         if (module_dom->rx_power_high_alarm) {
             smap_add(&pm_info, "rx_power_high_alarm", module_dom->rx_power_high_alarm);
         }
@@ -383,9 +392,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "rx_power_low_warning_threshold", module_dom->rx_power_low_warning_threshold);
         }
 
-        if (module_dom->tx_power) {
-            smap_add(&pm_info, "tx_power", module_dom->tx_power);
-        }
         if (module_dom->rx_power_high_alarm) {
             smap_add(&pm_info, "tx_power_high_alarm", module_dom->tx_power_high_alarm);
         }
@@ -411,15 +417,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "tx_power_low_warning_threshold", module_dom->tx_power_low_warning_threshold);
         }
 
-
-
-        if (module_dom->tx1_bias) {
-            smap_add(&pm_info, "tx1_bias", module_dom->tx1_bias);
-        }
-        if (module_dom->rx1_power) {
-            smap_add(&pm_info, "rx1_power", module_dom->rx1_power);
-        }
-
         if (module_dom->tx1_bias_high_alarm) {
             smap_add(&pm_info, "tx1_bias_high_alarm", module_dom->tx1_bias_high_alarm);
         }
@@ -470,15 +467,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "rx1_power_low_warning_threshold", module_dom->rx1_power_low_warning_threshold);
         }
 
-
-
-        if (module_dom->tx2_bias) {
-            smap_add(&pm_info, "tx2_bias", module_dom->tx2_bias);
-        }
-        if (module_dom->rx2_power) {
-            smap_add(&pm_info, "rx2_power", module_dom->rx2_power);
-        }
-
         if (module_dom->tx2_bias_high_alarm) {
             smap_add(&pm_info, "tx2_bias_high_alarm", module_dom->tx2_bias_high_alarm);
         }
@@ -529,15 +517,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "rx2_power_low_warning_threshold", module_dom->rx2_power_low_warning_threshold);
         }
 
-
-
-        if (module_dom->tx3_bias) {
-            smap_add(&pm_info, "tx3_bias", module_dom->tx3_bias);
-        }
-        if (module_dom->rx3_power) {
-            smap_add(&pm_info, "rx3_power", module_dom->rx3_power);
-        }
-
         if (module_dom->tx3_bias_high_alarm) {
             smap_add(&pm_info, "tx3_bias_high_alarm", module_dom->tx3_bias_high_alarm);
         }
@@ -588,15 +567,6 @@ pm_ovsdb_update(void)
             smap_add(&pm_info, "rx3_power_low_warning_threshold", module_dom->rx3_power_low_warning_threshold);
         }
 
-
-
-        if (module_dom->tx4_bias) {
-            smap_add(&pm_info, "tx4_bias", module_dom->tx4_bias);
-        }
-        if (module_dom->rx4_power) {
-            smap_add(&pm_info, "rx4_power", module_dom->rx4_power);
-        }
-
         if (module_dom->tx4_bias_high_alarm) {
             smap_add(&pm_info, "tx4_bias_high_alarm", module_dom->tx4_bias_high_alarm);
         }
@@ -642,9 +612,14 @@ pm_ovsdb_update(void)
         }
         if (module_dom->rx4_power_high_warning_threshold) {
             smap_add(&pm_info, "rx4_power_high_warning_threshold", module_dom->rx4_power_high_warning_threshold);
-        }*/
-        if (module_dom) {
-            ;//smap_add(&pm_info, "rx4_power_low_warning_threshold", module_dom->rx4_power_low_warning_threshold);
+        }
+        if (module_dom->rx4_power_low_warning_threshold) {
+            smap_add(&pm_info, "rx4_power_low_warning_threshold", module_dom->rx4_power_low_warning_threshold);
+        }
+
+        // DOM aggregates of the windows closed so far
+        SMAP_FOR_EACH(dom_stat, &port->dom_stats.published) {
+            smap_add(&pm_info, dom_stat->key, dom_stat->value);
         }
 
         ovsrec_interface_set_pm_info(intf, &pm_info);
@@ -668,12 +643,21 @@ pm_ovsdb_update(void)
     ovsdb_idl_txn_commit_block(txn);
     ovsdb_idl_txn_destroy(txn);
 
+    // identities restored from the snapshot went out with this update
+    if (cur_hw_set) {
+        pm_snapshot_published();
+    }
 }
 
 static void
 pmd_free_pm_port(pm_port_t *port)
 {
     pm_delete_all_data(port);
+    pm_dom_history_destroy(port);
+    pm_dom_stats_destroy(port);
+    pm_cmis_destroy(port);
+    pm_upper_destroy(port);
+    pm_backend_port_destroy(port);
     free(port->instance);
     free(port);
 }
@@ -836,6 +820,8 @@ pm_interface_dump(struct ds *ds, pm_port_t *port)
 {
     struct ovs_module_info *module;
 
+    pm_decode_details(port);
+
     module = &port->ovs_module_columns;
     ds_put_format(ds, "Pluggable info for Interface %s:\n", port->instance);
     if (module->cable_length) {
@@ -886,6 +872,9 @@ pm_interface_dump(struct ds *ds, pm_port_t *port)
         ds_put_format(ds, "    vendor_serial_number   = %s\n",
                       module->vendor_serial_number);
     }
+    pm_cmis_dump(ds, port);
+    pm_upper_dump(ds, port);
+    pm_breaker_dump(ds, &port->breaker, time_msec());
 }
 
 static void
@@ -929,8 +918,20 @@ pm_debug_dump(struct ds *ds, int argc, const char *argv[])
 
         if (!strcmp(table_name, "interface")) {
             pm_interfaces_dump(ds, argc, argv);
+        } else if (!strcmp(table_name, "bus")) {
+            pm_bus_dump(ds);
+        } else if (!strcmp(table_name, "io")) {
+            pm_io_dump(ds);
+        } else if (!strcmp(table_name, "ident")) {
+            pm_ident_dump(ds);
+        } else if (!strcmp(table_name, "snapshot")) {
+            pm_snapshot_dump(ds);
         }
     } else {
         pm_interfaces_dump(ds, 0, NULL);
+        pm_bus_dump(ds);
+        pm_io_dump(ds);
+        pm_ident_dump(ds);
+        pm_snapshot_dump(ds);
     }
 }
@@ -22,6 +22,7 @@
  ***************************************************************************/
 
 #define _GNU_SOURCE
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -33,17 +34,33 @@
 
 #include <vswitch-idl.h>
 #include <openswitch-idl.h>
+#include <timeval.h>
+#include <util.h>
 
 #include "pmd.h"
 #include "plug.h"
 #include "pm_dom.h"
+#include "pm_backend.h"
+#include "pm_ident.h"
+#include "pm_snapshot.h"
+#include "pm_cmis.h"
+#include "pm_upper.h"
 
 VLOG_DEFINE_THIS_MODULE(plug);
 
+BUILD_ASSERT_DECL(sizeof(pm_sfp_serial_id_t) == PM_SERIAL_ID_LEN);
+
+// the vendor serial number sits at the same place in the SFP and QSFP
+// serial ID pages; CMIS moved it
+#define PM_SERIAL_NUMBER_OFFSET offsetof(pm_sfp_serial_id_t, vendor_serial_number)
+#define PM_CMIS_SERIAL_NUMBER_OFFSET \
+    offsetof(pm_cmis_serial_id_t, vendor_serial_number)
+
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_serial_id_t, vendor_serial_number) ==
+                  PM_SERIAL_NUMBER_OFFSET);
+
 extern struct shash ovs_intfs;
-extern YamlConfigHandle global_yaml_handle;
 
-extern int sfpp_sum_verify(unsigned char *);
 extern int pm_parse(pm_sfp_serial_id_t *serial_datap, pm_port_t *port);
 
 
@@ -86,8 +103,6 @@ pm_set_enabled(void)
     return 0;
 }
 
-#define MAX_DEVICE_NAME_LEN 1024
-
 //
 // pm_delete_all_data：将所有属性标记为已删除
 //除了连接器，它始终存在
@@ -96,96 +111,105 @@ void
 pm_delete_all_data(pm_port_t *port)
 {
     DELETE(port, connector_status);
-    DELETE_FREE(port, supported_speeds);
+    DELETE(port, supported_speeds);
     DELETE(port, cable_technology);
     DELETE_FREE(port, cable_length);
-    DELETE_FREE(port, max_speed);
+    DELETE(port, max_speed);
     DELETE(port, power_mode);
-    DELETE_FREE(port, vendor_name);
-    DELETE_FREE(port, vendor_oui);
-    DELETE_FREE(port, vendor_part_number);
-    DELETE_FREE(port, vendor_revision);
-    DELETE_FREE(port, vendor_serial_number);
+    DELETE_INTERN(port, vendor_name);
+    DELETE_INTERN(port, vendor_oui);
+    DELETE_INTERN(port, vendor_part_number);
+    DELETE(port, vendor_revision);
+    DELETE(port, vendor_serial_number);
     DELETE_FREE(port, a0);
     DELETE_FREE(port, a2);
     DELETE_FREE(port, a0_uppers);
+    pm_dom_columns_clear(port);
+    pm_dom_stats_clear(port);
 }
 
-static bool
-pm_get_presence(pm_port_t *port)
+//
+// pm_get_presence: read whether a module is plugged in
+//
+// input: port structure, presence to fill in
+//
+// output: 0 on success, -1 if presence could not be read
+//
+static int
+pm_get_presence(pm_port_t *port, bool *present)
 {
-#ifdef PLATFORM_SIMULATION
-    if (NULL != port->module_data) {
-        return true;
-    }
-    return false;
-#else
-    //存在检测数据
-    bool                present;
-    uint32_t            result;
-
     int rc;
 
-    // i2c界面结构
-    i2c_bit_op *        reg_op;
-
-    //如果数据无效或操作失败，则重试5次
-    int                 retry_count = 2;
+    unsigned int        attempt = 1;
 
-    if (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
-        reg_op = port->module_device->module_signals.sfp.sfpp_mod_present;
-    } else if (0 == strcmp(port->module_device->connector,
-                           CONNECTOR_QSFP_PLUS)) {
-        reg_op = port->module_device->module_signals.qsfp.qsfpp_mod_present;
-    } else if (0 == strcmp(port->module_device->connector,
-                           CONNECTOR_QSFP28)) {
-        reg_op = port->module_device->module_signals.qsfp28.qsfp28p_mod_present;
-    } else {
+    if (0 != strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS) &&
+        0 != strcmp(port->module_device->connector, CONNECTOR_QSFP_PLUS) &&
+        0 != strcmp(port->module_device->connector, CONNECTOR_QSFP28) &&
+        NULL == port->cmis) {
         VLOG_ERR("port is not pluggable: %s", port->instance);
-        return false;
+        return -1;
     }
-retry_read:
 
-    //执行该操作
-    rc = i2c_reg_read(global_yaml_handle, port->subsystem, reg_op, &result);
+    // use the result of the sweep's batched check, unless it failed
+    if (port->prefetch.presence_valid) {
+        port->prefetch.presence_valid = false;
+        if (0 == port->prefetch.presence_rc) {
+            *present = port->prefetch.present;
+            return 0;
+        }
+    }
 
-    if (rc != 0) {
-        if (retry_count != 0) {
-            VLOG_WARN("module presence read failed, retrying: %s",
-                      port->instance);
-            retry_count--;
-            goto retry_read;
+    for (;;) {
+        rc = pm_backend_presence(port, present);
+        if (0 == rc) {
+            break;
         }
-        VLOG_ERR("unable to read module presence: %s", port->instance);
-        return false;
+        if (!pm_retry_again(&pm_retry_presence, &attempt)) {
+            VLOG_ERR("unable to read module presence: %s", port->instance);
+            return -1;
+        }
+        VLOG_WARN("module presence read failed, retrying: %s",
+                  port->instance);
     }
 
-    //计算出现
-    present = (result != 0);
+    return 0;
+}
 
-    return present;
-#endif
+//
+// pm_read_serial_id: read a byte range of the serial ID page, on the
+//                    upper page 00h of modules that have several
+//
+static int
+pm_read_serial_id(pm_port_t *port, size_t offset, size_t len,
+                  unsigned char *data)
+{
+    // the serial ID of a CMIS module is upper page 00h
+    if (NULL != port->cmis) {
+        return pm_cmis_read(port, 0, 0, offset, len, data);
+    }
+
+    return pm_upper_read(port, PM_UPPER_SERIAL_ID, offset, len, data);
 }
 
 static int
 pm_read_a0(pm_port_t *port, unsigned char *data, size_t offset)
 {
-#ifdef PLATFORM_SIMULATION
-    memcpy(data, port->module_data, sizeof(pm_sfp_serial_id_t));
-    return 0;
-#else
-    //设备数据
-    const YamlDevice *device;
-
+    unsigned int        attempt = 1;
     int                 rc;
 
     // OPS_TODO：需要读取QSFP模块的准备位（？）
 
-         //获取模块eeprom的设备
-    device = yaml_find_device(global_yaml_handle, port->subsystem, port->module_device->module_eeprom);
+    if (port->prefetch.a0_valid) {
+        port->prefetch.a0_valid = false;
+        if (0 == port->prefetch.a0_rc) {
+            memcpy(data, port->prefetch.a0, sizeof(pm_sfp_serial_id_t));
+            return 0;
+        }
+    }
 
-    rc = i2c_data_read(global_yaml_handle, device, port->subsystem, offset,
-                       sizeof(pm_sfp_serial_id_t), data);
+    do {
+        rc = pm_read_serial_id(port, offset, sizeof(pm_sfp_serial_id_t), data);
+    } while (rc != 0 && pm_retry_again(&pm_retry_eeprom, &attempt));
 
     if (rc != 0) {
         VLOG_ERR("module read failed: %s", port->instance);
@@ -193,43 +217,306 @@ pm_read_a0(pm_port_t *port, unsigned char *data, size_t offset)
     }
 
     return 0;
-#endif
 }
 
+//
+// pm_verify_a0: check a serial ID page against its check codes before it
+//               is parsed. A region that fails is read again on its own,
+//               pausing as pm_retry_checksum asks, which gets past a read
+//               corrupted on the bus without resetting the module.
+//
+// input: port structure, serial ID page, offset of the page
+//
+// output: 0 if every region checks out, -1 otherwise
+//
 static int
-pm_read_a2(pm_port_t *port, unsigned char *a2_data)
+pm_verify_a0(pm_port_t *port, unsigned char *a0, size_t offset)
 {
-#ifdef PLATFORM_SIMULATION
-    return -1;
-#else
-    //设备数据
-    const YamlDevice    *device;
+    const pm_id_region_t    *regions;
+    const pm_id_region_t    *region;
+    size_t                  n_regions;
+    size_t                  idx;
+    unsigned int            attempt;
+    int                     rc;
+
+    n_regions = pm_id_regions(port->module_device->connector, &regions);
+    for (idx = 0; idx < n_regions; idx++) {
+        region = &regions[idx];
+        attempt = 1;
+
+        while (!pm_id_region_valid(region, a0)) {
+            if (!pm_retry_again(&pm_retry_checksum, &attempt)) {
+                VLOG_WARN("module serial ID data failed checksum "
+                          "(bytes %zu-%zu): %s", region->offset,
+                          region->offset + region->len - 1, port->instance);
+                return -1;
+            }
+            VLOG_DBG("module serial ID data failed checksum, rereading "
+                     "bytes %zu-%zu: %s", region->offset,
+                     region->offset + region->len - 1, port->instance);
+
+            rc = pm_read_serial_id(port, offset + region->offset,
+                                   region->len, a0 + region->offset);
+            if (rc != 0) {
+                VLOG_WARN("module serial ID reread failed: %s",
+                          port->instance);
+                return -1;
+            }
+        }
+    }
 
-    int                 rc;
-    char                a2_device_name[MAX_DEVICE_NAME_LEN];
+    return 0;
+}
 
-    VLOG_DBG("Read A2 address from yaml files.");
+//
+// pm_serial_id_failed: publish a module whose serial ID could not be read
+//                      or failed its checksum as unrecognized. It is read
+//                      again on the next sweep; publishing the same state
+//                      then writes nothing to the database.
+//
+// input: port structure
+//
+// output: none
+//
+static void
+pm_serial_id_failed(pm_port_t *port)
+{
+    pm_delete_all_data(port);
+    port->present = true;
+    port->retry = true;
+    SET_CONST_STRING(port, connector,
+                     OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
+    SET_CONST_STRING(port, connector_status,
+                     OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
+}
+
+//
+// pm_dom_eeprom: EEPROM holding the DOM page: A2h for SFP+, A0h (lower
+//                page) otherwise.
+//
+static enum pm_eeprom
+pm_dom_eeprom(const pm_port_t *port)
+{
     if (strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS) == 0) {
-        strncpy(a2_device_name, port->module_device->module_eeprom, MAX_DEVICE_NAME_LEN);
-        strncat(a2_device_name, "_dom", MAX_DEVICE_NAME_LEN);
-    }
-    else {
-        strncpy(a2_device_name, port->module_device->module_eeprom, MAX_DEVICE_NAME_LEN);
+        return PM_EEPROM_A2;
     }
 
-    //构建A2设备
-    device = yaml_find_device(global_yaml_handle, port->subsystem, a2_device_name);
+    return PM_EEPROM_A0;
+}
 
-    rc = i2c_data_read(global_yaml_handle, device, port->subsystem, 0,
-                       sizeof(pm_sfp_dom_t), a2_data);
+//
+// pm_read_a2: read a byte range of the DOM page into the same offset of
+//             the port's copy. SFPs keep it at A2h, QSFPs in the lower
+//             page; CMIS modules also have upper pages (see pm_cmis).
+//
+static int
+pm_read_a2(pm_port_t *port, const pm_dom_read_t *read)
+{
+    int                 rc;
+
+    if (NULL != port->cmis) {
+        rc = pm_cmis_read_dom(port, read);
+    } else {
+        rc = pm_backend_read(port, pm_dom_eeprom(port), 0, read->offset,
+                             read->len, port->dom.page + read->offset);
+    }
 
     if (rc != 0) {
-        VLOG_ERR("module dom read failed: %s", port->instance);
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_ERR_RL(&rl, "module dom read failed: %s", port->instance);
+        return -1;
+    }
+
+    return 0;
+}
+
+//
+// pm_read_dom: read the parts of the DOM page that are due and refresh
+//              the DOM data from the updated page
+//
+// input: port structure
+//
+// output: 1 if nothing was due, 0 if a read succeeded, -1 if all failed
+//
+static int
+pm_read_dom(pm_port_t *port)
+{
+    pm_dom_read_t   reads[PM_DOM_MAX_READS];
+    size_t          count;
+    size_t          idx;
+    bool            prefetched = port->prefetch.dom_valid;
+    bool            updated = false;
+    unsigned int    attempt;
+    int             rc;
+
+    // the sweep may already have planned and read this port's ranges
+    if (prefetched) {
+        port->prefetch.dom_valid = false;
+        count = port->prefetch.n_dom;
+        memcpy(reads, port->prefetch.dom, count * sizeof(reads[0]));
+    } else {
+        count = pm_dom_plan(port, time_msec(), reads);
+    }
+
+    for (idx = 0; idx < count; idx++) {
+        attempt = 1;
+
+        if (prefetched && port->prefetch.dom_batched[idx]) {
+            rc = port->prefetch.dom_rc[idx];
+        } else {
+            rc = pm_read_a2(port, &reads[idx]);
+        }
+        while (rc != 0 && pm_retry_again(&pm_retry_eeprom, &attempt)) {
+            rc = pm_read_a2(port, &reads[idx]);
+        }
+
+        if (rc != 0) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+            VLOG_WARN_RL(&rl, "module a2 read failed: %s", port->instance);
+            continue;
+        }
+
+        if (0 == reads[idx].offset && PM_DOM_PAGE_SIZE == reads[idx].len) {
+            port->dom.valid = true;
+        }
+        if (NULL != port->cmis) {
+            pm_cmis_loaded(port, &reads[idx]);
+        }
+        updated = true;
+    }
+
+    // thresholds are unknown until the page has been read in full
+    if (updated && port->dom.valid) {
+        pm_set_a2(port, (pm_sfp_dom_t *)port->dom.page);
+    }
+
+    if (0 == count) {
+        return 1;
+    }
+
+    return updated ? 0 : -1;
+}
+
+//
+// pm_serial_id_offset: find where a port's serial ID data starts
+//
+// input: port structure, offset to fill in
+//
+// output: 0 for pluggable ports, -1 otherwise
+//
+static int
+pm_serial_id_offset(const pm_port_t *port, unsigned char *offset)
+{
+    if (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
+        *offset = SFP_SERIAL_ID_OFFSET;
+    } else if ((0 == strcmp(port->module_device->connector,
+                            CONNECTOR_QSFP_PLUS)) ||
+               (0 == strcmp(port->module_device->connector,
+                            CONNECTOR_QSFP28)) ||
+               NULL != port->cmis) {
+        *offset = QSFP_SERIAL_ID_OFFSET;
+    } else {
         return -1;
     }
 
     return 0;
-#endif
+}
+
+//
+// pm_identify: set up a port's identity from its serial ID page
+//
+// input: port structure, serial ID page
+//
+// output: 0 on success, as pm_parse() otherwise
+//
+static int
+pm_identify(pm_port_t *port, pm_sfp_serial_id_t *a0)
+{
+    int rc;
+
+    // the other columns are decoded from the page on demand
+    port->details_valid = false;
+    pm_upper_reset(port);
+
+    // parse the data into important fields, and set it as pending
+    // data, unless the same serial ID was decoded before
+    if (pm_ident_lookup(port, (unsigned char *)a0)) {
+        return 0;
+    }
+
+    rc = pm_parse(a0, port);
+    if (rc == 0) {
+        set_a2_read_request(port, a0);
+        pm_ident_store(port, (unsigned char *)a0);
+    }
+
+    return rc;
+}
+
+//
+// pm_restore_port: identify a new port from the snapshot of the previous
+//                  run, without accessing the module
+//
+// input: port structure
+//
+// output: none
+//
+void
+pm_restore_port(pm_port_t *port)
+{
+    pm_sfp_serial_id_t a0;
+
+    if (!pm_snapshot_take(port->instance, port->module_device->connector,
+                          (unsigned char *)&a0)) {
+        return;
+    }
+
+    if (0 != pm_identify(port, &a0)) {
+        return;
+    }
+
+    memcpy(port->serial_id, &a0, sizeof(port->serial_id));
+    port->present = true;
+    port->retry = false;
+    port->restored = true;
+}
+
+//
+// pm_verify_restored: check that a port restored from the snapshot still
+//                     holds that module, by its serial number alone
+//
+// input: port structure, offset of its serial ID page
+//
+// output: 0 if it does, -1 if the module must be read in full
+//
+static int
+pm_verify_restored(pm_port_t *port, unsigned char offset)
+{
+    unsigned char   sn[PM_VENDOR_SN_LEN];
+    size_t          sn_offset = PM_SERIAL_NUMBER_OFFSET;
+    bool            match;
+    int             rc;
+
+    port->restored = false;
+
+    if (NULL != port->cmis) {
+        // nothing is known of the page the module was left on
+        sn_offset = PM_CMIS_SERIAL_NUMBER_OFFSET;
+        pm_cmis_forget(port);
+        rc = pm_cmis_read(port, 0, 0, offset + sn_offset, sizeof(sn), sn);
+    } else {
+        rc = pm_upper_read(port, PM_UPPER_SERIAL_ID, offset + sn_offset,
+                           sizeof(sn), sn);
+    }
+    port->sweep.accessed = true;
+
+    match = (0 == rc &&
+             0 == memcmp(sn, port->serial_id + sn_offset, sizeof(sn)));
+    pm_snapshot_verified(port->instance, match);
+
+    return match ? 0 : -1;
 }
 
 //
@@ -251,139 +538,186 @@ pm_read_module_state(pm_port_t *port)
     //串行ID数据（SFP +结构）
     pm_sfp_serial_id_t a0;
 
-    // a2页面仅适用于SFP +
-    pm_sfp_dom_t a2;
-    // unsigned char   a2[PM_SFP_A2_PAGE_SIZE];
-
-      //如果数据无效或操作失败，则重试最多2次
-    int             retry_count = 2;
     unsigned char   offset;
 
     memset(&a0, 0, sizeof(a0));
-    memset(&a2, 0, sizeof(a2));
+    memset(&port->sweep, 0, sizeof(port->sweep));
 
 // SFP +和QSFP串行ID数据处于不同的偏移量
          //借此机会获得正确的存在检测操作
 
-    if (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
-        offset = SFP_SERIAL_ID_OFFSET;
-    } else if ((0 == strcmp(port->module_device->connector,
-                            CONNECTOR_QSFP_PLUS)) ||
-               (0 == strcmp(port->module_device->connector,
-                            CONNECTOR_QSFP28))) {
-        offset = QSFP_SERIAL_ID_OFFSET;
-    } else {
+    if (0 != pm_serial_id_offset(port, &offset)) {
         VLOG_ERR("port is not pluggable: %s", port->instance);
         return -1;
     }
 
-retry_read:
-    present = pm_get_presence(port);
+    pm_bus_set_class(PM_OP_PRESENCE);
 
-    if (!present && false) {    
-      //仅当模块以前存在或更新时才更新
-               //条目未初始化。
-        if ((port->present == true) ||
+    // a failed presence read says nothing about the module, which stays
+    // published as it was; the breaker parks a port that keeps failing
+    if (0 != pm_get_presence(port, &present)) {
+        port->sweep.accessed = true;
+        port->sweep.failed = true;
+        return 0;
+    }
+    pm_breaker_presence(&port->breaker, present);
+
+    if (!present) {
+        // only update if the module was there before, or the entry was
+        // never set
+        if (port->present || port->retry || port->restored ||
             (NULL == port->ovs_module_columns.connector)) {
-          //从条目中删除当前数据
+            if (port->present) {
+                pm_snapshot_changed();
+            }
             port->present = false;
+            port->retry = false;
+            port->restored = false;
+            port->a2_read_requested = false;
             pm_delete_all_data(port);
-            //设置存在枚举
             SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_ABSENT);
             SET_STATIC_STRING(port, connector_status,
                               OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
             VLOG_DBG("module is not present for port: %s", port->instance);
         }
-        return 0;    
+        return 0;
+    }
+
+    // leave the module alone while the port is parked or its bus is
+    // being recovered
+    if (!pm_breaker_allow(&port->breaker, time_msec()) ||
+        pm_bus_quarantined(pm_backend_port_bus(port))) {
+        return 0;
+    }
+
+    // a module restored from the snapshot stays published until the
+    // first update is out, and is then read in full only if its serial
+    // number changed
+    if (port->restored) {
+        if (!pm_snapshot_verifying() ||
+            !pm_bus_admit(pm_backend_port_bus(port), PM_OP_IDENTIFY)) {
+            return 0;
+        }
+        pm_bus_set_class(PM_OP_IDENTIFY);
+
+        if (0 != pm_verify_restored(port, offset)) {
+            port->retry = true;
+        }
     }
 
     if (port->present == false || port->retry == true) {
         //还没有读取A0数据
 
+        // identification waits for budget unless already prefetched
+        if (!port->prefetch.a0_valid &&
+            !pm_bus_admit(pm_backend_port_bus(port), PM_OP_IDENTIFY)) {
+            return 0;
+        }
+        pm_bus_set_class(PM_OP_IDENTIFY);
+
         VLOG_DBG("module is present for port: %s", port->instance);
 
-        rc = pm_read_a0(port, (unsigned char *)&a0, offset);
+        // a new CMIS module starts on page 00h, whatever the last one
+        // was left on
+        if (port->present == false) {
+            pm_cmis_forget(port);
+        }
 
-        if (rc != 0 && false) {
-            if (retry_count != 0) {
-                VLOG_DBG("module serial ID data read failed, resetting and retrying: %s",
-                         port->instance);
-                pm_reset_port(port);
-                retry_count--;
-                goto retry_read;
-            }
-            VLOG_WARN("module serial ID data read failed: %s", port->instance);
-            pm_delete_all_data(port);
-            port->present = true;
-            port->retry = true;
-            SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
-            SET_STATIC_STRING(port, connector_status,
-                              OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
-            return -1;
+        rc = pm_read_a0(port, (unsigned char *)&a0, offset);
+        if (rc == 0) {
+            rc = pm_verify_a0(port, (unsigned char *)&a0, offset);
         }
+        port->sweep.accessed = true;
+        port->sweep.failed = (rc != 0);
 
-        /*
-        // do checksum validation
-        if (sfpp_sum_verify((unsigned char *)&a0) != 0) {
-            if (retry_count != 0) {
-                VLOG_DBG("module serial ID data failed checksum, resetting and retrying: %s", port->instance);
-                pm_reset_port(port);
-                retry_count--;
-                goto retry_read;
-            }
-            VLOG_WARN("module serial ID data failed checksum: %s", port->instance);
-            // mark port as present
-            port->present = true;
-            port->retry = true;
-            // delete all attributes, set "unknown" value
-            pm_delete_all_data(port);
-            SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
-            SET_STATIC_STRING(port, connector_status,
-                              OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
+        // a module that cannot be read or fails its checksum is never
+        // parsed; the breaker takes care of one that keeps failing
+        if (rc != 0) {
+            pm_serial_id_failed(port);
             return -1;
         }
-        */
 
-        // parse the data into important fields, and set it as pending data
-        rc = pm_parse(&a0, port);
+        rc = pm_identify(port, &a0);
 
         if (rc == 0) {
           //将端口标记为现在
             port->present = true;
             port->retry = false;
-            set_a2_read_request(port, &a0);
+            if (0 != memcmp(port->serial_id, &a0, sizeof(port->serial_id))) {
+                memcpy(port->serial_id, &a0, sizeof(port->serial_id));
+                pm_snapshot_changed();
+            }
         } else {
             port->retry = true;
+            port->sweep.failed = true;
             //注意：在失败的情况下，pm_parse已经被记录
                          //一个适当的消息。
             VLOG_DBG("pm_parse has failed for port %s", port->instance);
         }
     }
 
-    if (port->a2_read_requested == false || true) {
-        return 0;
+    // upper pages of a QSFP are read once it is identified, and again
+    // when requested
+    if (port->present && !port->retry && !port->restored &&
+        pm_upper_due(port) &&
+        pm_bus_admit(pm_backend_port_bus(port), PM_OP_IDENTIFY)) {
+        pm_bus_set_class(PM_OP_IDENTIFY);
+        rc = pm_upper_refresh(port);
+        port->sweep.accessed = true;
+        port->sweep.failed = port->sweep.failed || (rc != 0);
     }
 
-retry_read_a2:
-    rc = pm_read_a2(port, (unsigned char *)&a2);
+    // DOM polling is done once every port has been identified
+    port->sweep.telemetry = port->a2_read_requested;
 
-    if (rc != 0) {
-        if (retry_count != 0) {
-            VLOG_DBG("module a2 read failed, retrying: %s", port->instance);
-            retry_count--;
-            goto retry_read_a2;
-        }
+    return 0;
+}
 
-        VLOG_WARN("module a2 read failed: %s", port->instance);
+//
+// pm_read_telemetry: poll the DOM ranges of a port that are due, if the
+//                    bus budget allows; otherwise they stay due
+//
+// input: port structure
+//
+// output: none
+//
+static void
+pm_read_telemetry(pm_port_t *port)
+{
+    int rc;
 
-        memset(&a2, 0xff, sizeof(a2));
+    if (pm_bus_quarantined(pm_backend_port_bus(port))) {
+        return;
+    }
+    if (!port->prefetch.dom_valid &&
+        !pm_bus_admit(pm_backend_port_bus(port), PM_OP_TELEMETRY)) {
+        return;
     }
+    pm_bus_set_class(PM_OP_TELEMETRY);
 
-    pm_set_a2(port, &a2);
+    rc = pm_read_dom(port);
+    if (rc <= 0) {
+        port->sweep.accessed = true;
+        port->sweep.failed = port->sweep.failed || (rc < 0);
+    }
+}
 
-    port->a2_read_requested = false;
+//
+// pm_sweep_finish: feed the outcome of a port's sweep to its breaker.
+//                  Failures on a bus that hung are the bus's fault.
+//
+static void
+pm_sweep_finish(pm_port_t *port)
+{
+    if (pm_bus_quarantined(pm_backend_port_bus(port))) {
+        return;
+    }
 
-    return 0;
+    if (port->sweep.accessed && port->sweep.failed) {
+        pm_breaker_failure(&port->breaker, port->instance, time_msec());
+    } else if (port->sweep.accessed) {
+        pm_breaker_success(&port->breaker, port->instance);
+    }
 }
 
 //
@@ -405,6 +739,277 @@ pm_read_port_state(pm_port_t *port)
     return 0;
 }
 
+//
+// pm_sweep_compare: order ports by bus, then mux path, then name, so the
+//                   ports behind one mux leg are serviced back-to-back.
+//                   Ports without a module eeprom go last.
+//
+static int
+pm_sweep_compare(const void *a_, const void *b_)
+{
+    const pm_port_t *a = *(pm_port_t *const *)a_;
+    const pm_port_t *b = *(pm_port_t *const *)b_;
+    int rc;
+
+    if (NULL == a->bus || NULL == b->bus) {
+        if (a->bus != b->bus) {
+            return (NULL == a->bus) ? 1 : -1;
+        }
+    } else {
+        rc = strcmp(a->bus->name, b->bus->name);
+        if (0 != rc) {
+            return rc;
+        }
+        rc = strcmp(a->mux_path, b->mux_path);
+        if (0 != rc) {
+            return rc;
+        }
+    }
+
+    return strcmp(a->instance, b->instance);
+}
+
+//
+// pm_sweep_mux_switches: count the mux leg changes a sweep over ports in
+//                        the given order needs, one access per port
+//
+static unsigned int
+pm_sweep_mux_switches(pm_port_t *const ports[], size_t n)
+{
+    struct shash    selected = SHASH_INITIALIZER(&selected);
+    const char      *last;
+    unsigned int    switches = 0;
+    size_t          idx;
+
+    for (idx = 0; idx < n; idx++) {
+        if (NULL == ports[idx]->bus || '\0' == ports[idx]->mux_path[0]) {
+            continue;
+        }
+
+        last = shash_find_data(&selected, ports[idx]->bus->name);
+        if (NULL == last || 0 != strcmp(last, ports[idx]->mux_path)) {
+            shash_replace(&selected, ports[idx]->bus->name,
+                          ports[idx]->mux_path);
+            switches++;
+        }
+    }
+
+    shash_destroy(&selected);
+
+    return switches;
+}
+
+//
+// pm_sweep_order: list the ports in the order a sweep services them
+//
+// input: count to fill in
+//
+// output: allocated array of ports
+//
+static pm_port_t **
+pm_sweep_order(size_t *count)
+{
+    struct shash_node *node;
+    pm_port_t       **ports;
+    unsigned int    unordered;
+    unsigned char   offset;
+    size_t          n = 0;
+
+    ports = xmalloc(MAX(shash_count(&ovs_intfs), 1) * sizeof(*ports));
+
+    SHASH_FOR_EACH(node, &ovs_intfs) {
+        pm_port_t *port = (pm_port_t *)node->data;
+
+        if (0 == pm_serial_id_offset(port, &offset)) {
+            pm_backend_port_bus(port);
+        }
+        ports[n++] = port;
+    }
+
+    unordered = pm_sweep_mux_switches(ports, n);
+    qsort(ports, n, sizeof(*ports), pm_sweep_compare);
+    pm_bus_plan(unordered, pm_sweep_mux_switches(ports, n));
+
+    *count = n;
+
+    return ports;
+}
+
+//
+// pm_prefetch: issue the reads of a sweep as batches, so that a backend
+//              able to overlap them does. The first batch checks presence
+//              of every port; the second reads the serial ID of ports
+//              that need it and the DOM ranges now due on the others.
+//              Results are left in each port's prefetch for the per-port
+//              steps of the sweep, which read anything missing themselves.
+//
+// input: ports in sweep order, count
+//
+// output: none
+//
+static void
+pm_prefetch(pm_port_t *const order[], size_t n)
+{
+    struct pm_backend_req *reqs;
+    pm_port_t       **ports;
+    bool            *present;
+    int             *presence_rc;
+    int             **rc_of;            // where each request's rc goes
+    size_t          count = 0;
+    size_t          n_reqs = 0;
+    size_t          idx;
+    size_t          dom_idx;
+    long long int   now = time_msec();
+    unsigned char   offset;
+
+    if (!pm_backend_batched() || 0 == n) {
+        return;
+    }
+
+    ports = xmalloc(n * sizeof(*ports));
+    present = xmalloc(n * sizeof(*present));
+    presence_rc = xmalloc(n * sizeof(*presence_rc));
+
+    for (idx = 0; idx < n; idx++) {
+        pm_port_t *port = order[idx];
+
+        memset(&port->prefetch, 0, sizeof(port->prefetch));
+        if (0 == pm_serial_id_offset(port, &offset)) {
+            ports[count++] = port;
+        }
+    }
+
+    pm_bus_set_class(PM_OP_PRESENCE);
+    pm_backend_presence_batch(ports, count, present, presence_rc);
+
+    reqs = xmalloc(count * (1 + PM_DOM_MAX_READS) * sizeof(*reqs));
+    rc_of = xmalloc(count * (1 + PM_DOM_MAX_READS) * sizeof(*rc_of));
+
+    for (idx = 0; idx < count; idx++) {
+        pm_port_t *port = ports[idx];
+        pm_prefetch_t *pf = &port->prefetch;
+
+        pf->presence_valid = true;
+        pf->present = present[idx];
+        pf->presence_rc = presence_rc[idx];
+
+        // same conditions as pm_read_module_state; insertion unparks
+        if (!pm_breaker_due(&port->breaker, now) &&
+            !(pf->present && !port->breaker.present)) {
+            continue;
+        }
+
+        if (!pm_bus_usable(pm_backend_port_bus(port)) ||
+            !pm_bus_has_budget(pm_backend_port_bus(port), PM_OP_IDENTIFY)) {
+            // left to the per-port steps, which skip or defer it
+            continue;
+        }
+
+        if (port->present == false || port->retry == true) {
+            // nothing to identify in an empty cage; CMIS modules may need
+            // a page select first, and so may a QSFP that was not left on
+            // page 00h
+            if (!pf->present || 0 != pf->presence_rc ||
+                NULL != port->cmis ||
+                !pm_upper_selected(port, PM_UPPER_SERIAL_ID)) {
+                continue;
+            }
+            pm_serial_id_offset(port, &offset);
+            reqs[n_reqs] = (struct pm_backend_req) {
+                .port = port,
+                .eeprom = PM_EEPROM_A0,
+                .page = PM_UPPER_SERIAL_ID,
+                .offset = offset,
+                .len = sizeof(pf->a0),
+                .data = pf->a0,
+            };
+            rc_of[n_reqs++] = &pf->a0_rc;
+            pf->a0_valid = true;
+        } else if (port->a2_read_requested && !port->restored &&
+                   pf->present && 0 == pf->presence_rc) {
+            pf->n_dom = pm_dom_plan(port, now, pf->dom);
+            pf->dom_valid = true;
+            for (dom_idx = 0; dom_idx < pf->n_dom; dom_idx++) {
+                pm_dom_read_t *read = &pf->dom[dom_idx];
+                unsigned char *data = port->dom.page + read->offset;
+
+                // batches cannot select pages, so only the lower page
+                // and the upper page in effect (any page, with a paged
+                // backend) are read ahead; the rest is left to
+                // pm_read_dom()
+                if (NULL != port->cmis) {
+                    if (read->offset >= PM_CMIS_UPPER_OFFSET &&
+                        (port->cmis->flat ||
+                         !pm_cmis_selected(port, read->bank, read->page))) {
+                        continue;
+                    }
+                    data = pm_cmis_buffer(port, read);
+                    if (NULL == data) {
+                        continue;
+                    }
+                }
+
+                reqs[n_reqs] = (struct pm_backend_req) {
+                    .port = port,
+                    .eeprom = pm_dom_eeprom(port),
+                    .page = read->page,
+                    .offset = read->offset,
+                    .len = read->len,
+                    .data = data,
+                };
+                rc_of[n_reqs++] = &pf->dom_rc[dom_idx];
+                pf->dom_batched[dom_idx] = true;
+            }
+        }
+    }
+
+    // identification and telemetry share a budget, so the class of the
+    // batch only matters for the breakdown of bus time
+    pm_bus_set_class(PM_OP_TELEMETRY);
+    pm_backend_read_batch(reqs, n_reqs);
+
+    for (idx = 0; idx < n_reqs; idx++) {
+        *rc_of[idx] = reqs[idx].rc;
+    }
+
+    free(rc_of);
+    free(reqs);
+    free(presence_rc);
+    free(present);
+    free(ports);
+}
+
+//
+// pm_recover_bus: try to free a hung bus by resetting the module of its
+//                 last late operation. config-yaml has no way to clock
+//                 out a stuck device, and SFPs have no reset signal, in
+//                 which case the quarantine alone gives it time.
+//
+// input: bus
+//
+// output: none
+//
+static void
+pm_recover_bus(pm_bus_t *bus)
+{
+    pm_port_t *port = NULL;
+
+    if (!bus->hung) {
+        return;
+    }
+
+    if (NULL != bus->offender) {
+        port = shash_find_data(&ovs_intfs, bus->offender);
+    }
+    if (NULL != port && NULL != port->module_device) {
+        VLOG_WARN("bus %s: resetting module of port %s",
+                  bus->name, port->instance);
+        pm_reset_port(port);
+    }
+
+    pm_bus_recovered(bus);
+}
+
 //
 // pm_read_state：读取所有模块的状态
 //
@@ -415,16 +1020,37 @@ pm_read_port_state(pm_port_t *port)
 int
 pm_read_state(void)
 {
-    struct shash_node *node;
+    pm_port_t   **ports;
+    size_t      count;
+    size_t      idx;
 
-    SHASH_FOR_EACH(node, &ovs_intfs) {
-        pm_port_t *port;
+    ports = pm_sweep_order(&count);
 
-        port = (pm_port_t *)node->data;
+    pm_prefetch(ports, count);
 
-        pm_read_port_state(port);
+    // presence and identification of every port come before telemetry
+    for (idx = 0; idx < count; idx++) {
+        pm_read_port_state(ports[idx]);
+    }
+    for (idx = 0; idx < count; idx++) {
+        if (ports[idx]->sweep.telemetry) {
+            pm_read_telemetry(ports[idx]);
+        }
+    }
+    for (idx = 0; idx < count; idx++) {
+        pm_sweep_finish(ports[idx]);
     }
 
+    free(ports);
+
+    // anything until the next sweep is a control operation
+    pm_bus_set_class(PM_OP_CONTROL);
+    pm_backend_sweep_end();
+    pm_bus_for_each(pm_recover_bus);
+    pm_bus_sweep_end();
+
+    pm_snapshot_save();
+
     return 0;
 }
 
@@ -439,30 +1065,8 @@ void
 pm_configure_qsfp(pm_port_t *port)
 {
     uint8_t             data = 0x00;
+    uint8_t             mask;
     unsigned int        idx;
-
-#ifdef PLATFORM_SIMULATION
-    if (true == port->split) {
-        data = 0x00;
-        for (idx = 0; idx < MAX_SPLIT_COUNT; idx++) {
-
-            if (false == port->hw_enable_subport[idx]) {
-                data |= (1 << idx);
-            }
-        }
-    } else {
-        if (false == port->hw_enable) {
-            data = 0x0f;
-        } else {
-            data = 0x00;
-        }
-    }
-
-    port->port_enable = data;
-    return;
-#else
-    const YamlDevice    *device;
-
     int                 rc;
 
     if (false == port->present) {
@@ -490,10 +1094,18 @@ pm_configure_qsfp(pm_port_t *port)
         }
     }
 
-    device = yaml_find_device(global_yaml_handle, port->subsystem, port->module_device->module_eeprom);
-
-    rc = i2c_data_write(global_yaml_handle, device, port->subsystem,
-                        QSFP_DISABLE_OFFSET, sizeof(data), &data);
+    // CMIS modules have eight lanes, two per subport
+    if (NULL != port->cmis) {
+        mask = 0;
+        for (idx = 0; idx < MAX_SPLIT_COUNT; idx++) {
+            if (data & (1 << idx)) {
+                mask |= 0x3 << (2 * idx);
+            }
+        }
+        rc = pm_cmis_tx_disable(port, mask);
+    } else {
+        rc = pm_backend_tx_disable(port, data);
+    }
 
     if (0 != rc) {
         VLOG_WARN("Failed to write QSFP enable/disable: %s (%d)",
@@ -502,9 +1114,6 @@ pm_configure_qsfp(pm_port_t *port)
         VLOG_DBG("Set QSFP enabled/disable: %s to %0X",
                  port->instance, data);
     }
-
-    return;
-#endif
 }
 
 
@@ -520,23 +1129,9 @@ pm_configure_qsfp(pm_port_t *port)
 static void
 pm_reset(pm_port_t *port, clear_reset_t clear)
 {
-    i2c_bit_op *        reg_op = NULL;
-    uint32_t            data;
     int                 rc;
 
-    if (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP_PLUS)) {
-        reg_op = port->module_device->module_signals.qsfp.qsfpp_reset;
-    } else if (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP28)) {
-        reg_op = port->module_device->module_signals.qsfp28.qsfp28p_reset;
-    }
-
-    if (NULL == reg_op) {
-        VLOG_DBG("port %s does does not have a reset", port->instance);
-        return;
-    }
-
-    data = clear ? 0 : 0xffu;
-    rc = i2c_reg_write(global_yaml_handle, port->subsystem, reg_op, data);
+    rc = pm_backend_reset(port, SET_RESET == clear);
 
     if (rc != 0) {
         VLOG_WARN("Unable to %s reset for port: %s (%d)",
@@ -577,6 +1172,8 @@ pm_reset_port(pm_port_t *port)
     pm_reset(port, SET_RESET);
     nanosleep(&req, NULL);
     pm_clear_reset(port);
+    pm_cmis_forget(port);
+    pm_upper_forget(port);
 }
 
 //
@@ -589,27 +1186,7 @@ pm_reset_port(pm_port_t *port)
 void
 pm_configure_port(pm_port_t *port)
 {
-#ifdef PLATFORM_SIMULATION
-    bool                enabled;
-
-    if ((0 == strcmp(port->module_device->connector, CONNECTOR_QSFP_PLUS)) ||
-        (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP28))) {
-        pm_configure_qsfp(port);
-    } else {
-        enabled = port->hw_enable;
-
-        if (enabled) {
-            port->port_enable = 1;
-        } else {
-            port->port_enable = 0;
-        }
-    }
-
-    return;
-#else
     int                 rc;
-    uint32_t            data;
-    i2c_bit_op          *reg_op;
     bool                enabled;
 
     if (NULL == port) {
@@ -617,17 +1194,15 @@ pm_configure_port(pm_port_t *port)
     }
 
     if ((0 == strcmp(port->module_device->connector, CONNECTOR_QSFP_PLUS)) ||
-        (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP28))) {
+        (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP28)) ||
+        NULL != port->cmis) {
         pm_configure_qsfp(port);
         return;
     }
 
-    reg_op = port->module_device->module_signals.sfp.sfpp_tx_disable;
-
     enabled = port->hw_enable;
-    data = enabled ? 0: reg_op->bit_mask;
 
-    rc = i2c_reg_write(global_yaml_handle, port->subsystem, reg_op, data);
+    rc = pm_backend_tx_disable(port, enabled ? 0 : 1);
 
     if (rc != 0) {
         VLOG_WARN("Unable to set module disable for port: %s (%d)",
@@ -637,77 +1212,4 @@ pm_configure_port(pm_port_t *port)
 
     VLOG_DBG("set port %s to %s",
              port->instance, enabled ? "enabled" : "disabled");
-#endif
-}
-
-#ifdef PLATFORM_SIMULATION
-int
-pmd_sim_insert(const char *name, const char *file, struct ds *ds)
-{
-    struct shash_node *node;
-    pm_port_t *port;
-    FILE *fp;
-    unsigned char *data;
-
-    node = shash_find(&ovs_intfs, name);
-    if (NULL == node) {
-        ds_put_cstr(ds, "No such interface");
-        return -1;
-    }
-    port = (pm_port_t *)node->data;
-
-    if (NULL != port->module_data) {
-        free((void *)port->module_data);
-        port->module_data = NULL;
-    }
-
-    fp = fopen(file, "r");
-
-    if (NULL == fp) {
-        ds_put_cstr(ds, "Can't open file");
-        return -1;
-    }
-
-    data = (unsigned char *)malloc(sizeof(pm_sfp_serial_id_t));
-
-    if (1 != fread(data, sizeof(pm_sfp_serial_id_t), 1, fp)) {
-        ds_put_cstr(ds, "Unable to read data");
-        free(data);
-        fclose(fp);
-        return -1;
-    }
-
-    fclose(fp);
-
-    port->module_data = data;
-
-    ds_put_cstr(ds, "Pluggable module inserted");
-
-    return 0;
-}
-
-int
-pmd_sim_remove(const char *name, struct ds *ds)
-{
-    struct shash_node *node;
-    pm_port_t *port;
-
-    node = shash_find(&ovs_intfs, name);
-    if (NULL == node) {
-        ds_put_cstr(ds, "No such interface");
-        return -1;
-    }
-    port = (pm_port_t *)node->data;
-
-    if (NULL == port->module_data) {
-        ds_put_cstr(ds, "Pluggable module not present");
-        return -1;
-    }
-
-    free((void *)port->module_data);
-    port->module_data = NULL;
-
-    ds_put_cstr(ds, "Pluggable module removed");
-    return 0;
 }
-#endif
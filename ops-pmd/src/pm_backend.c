@@ -0,0 +1,407 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for pluggable module hardware access backend selection.
+ *
+ * The wrappers here are the only callers of the backend operations; they
+ * also charge every transaction to the port's bus for the occupancy
+ * statistics.
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util.h>
+
+#include "pmd.h"
+#include "plug.h"
+#include "pm_backend.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_backend);
+
+extern YamlConfigHandle global_yaml_handle;
+
+static const struct pm_backend_class *const pm_backends[] = {
+    &pm_backend_i2c,
+    &pm_backend_sim,
+    &pm_backend_file,
+    &pm_backend_sysfs,
+    &pm_backend_cpld,
+};
+
+#ifdef PLATFORM_SIMULATION
+static const struct pm_backend_class *pm_backend = &pm_backend_sim;
+#else
+static const struct pm_backend_class *pm_backend = &pm_backend_i2c;
+#endif
+static char *pm_backend_arg = NULL;
+
+//
+// pm_backend_select: choose the backend from a --backend argument
+//
+// input: "NAME" or "NAME:ARG"
+//
+// output: 0 on success, -1 if NAME is unknown
+//
+int
+pm_backend_select(const char *spec)
+{
+    const char  *colon = strchr(spec, ':');
+    size_t      len = colon ? (size_t)(colon - spec) : strlen(spec);
+    size_t      idx;
+
+    for (idx = 0; idx < ARRAY_SIZE(pm_backends); idx++) {
+        if (strlen(pm_backends[idx]->name) == len &&
+            0 == strncmp(pm_backends[idx]->name, spec, len)) {
+            pm_backend = pm_backends[idx];
+            free(pm_backend_arg);
+            pm_backend_arg = colon ? xstrdup(colon + 1) : NULL;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+//
+// pm_backend_init: initialize the selected backend, once the yaml
+//                  configuration has been loaded
+//
+void
+pm_backend_init(void)
+{
+    VLOG_INFO("using %s hardware access backend%s%s", pm_backend->name,
+              pm_backend_arg ? " with " : "",
+              pm_backend_arg ? pm_backend_arg : "");
+
+    if (NULL != pm_backend->init && 0 != pm_backend->init(pm_backend_arg)) {
+        VLOG_FATAL("unable to initialize %s backend", pm_backend->name);
+    }
+}
+
+void
+pm_backend_usage(void)
+{
+    size_t idx;
+
+    printf("\nHardware access backends (--backend=NAME[:ARG]):\n");
+    for (idx = 0; idx < ARRAY_SIZE(pm_backends); idx++) {
+        printf("  %-22s%s\n", pm_backends[idx]->name,
+               pm_backends[idx] == pm_backend ? " (default)" : "");
+        if (NULL != pm_backends[idx]->arg_usage) {
+            printf("      ARG: %s\n", pm_backends[idx]->arg_usage);
+        }
+    }
+}
+
+const char *
+pm_backend_name(void)
+{
+    return pm_backend->name;
+}
+
+//
+// pm_backend_image_offset: position of an eeprom range in a module image.
+//     Images use the optoe driver's linear layout. QSFP and CMIS images
+//     hold the lower page in bytes 0-127 and upper page N at 128 + 128N.
+//     SFP images hold A0h in bytes 0-255 and the A2h space from byte 256,
+//     its upper page N at 384 + 128N. An image of only 128 bytes holds
+//     just the serial ID block, like the sim backend's.
+//
+// input: port structure, image size, eeprom space, upper page, offset and
+//        length
+//
+// output: position in the image, -1 if the image does not hold the range
+//
+off_t
+pm_backend_image_offset(const pm_port_t *port, size_t size,
+                        enum pm_eeprom eeprom, uint8_t page, size_t offset,
+                        size_t len)
+{
+    bool    sfp;
+    size_t  base;
+    size_t  pos;
+
+    sfp = (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS));
+
+    if (sizeof(pm_sfp_serial_id_t) == size) {
+        base = sfp ? SFP_SERIAL_ID_OFFSET : QSFP_SERIAL_ID_OFFSET;
+
+        if (PM_EEPROM_A0 != eeprom || 0 != page || offset < base ||
+            offset + len > base + size) {
+            return -1;
+        }
+        return offset - base;
+    }
+
+    if (offset + len > PM_EEPROM_SPACE_SIZE) {
+        return -1;
+    }
+
+    base = (PM_EEPROM_A2 == eeprom) ? PM_EEPROM_SPACE_SIZE : 0;
+    if (0 == page || offset + len <= PM_EEPROM_PAGE_SIZE) {
+        pos = base + offset;
+    } else if (offset < PM_EEPROM_PAGE_SIZE ||
+               (sfp && PM_EEPROM_A0 == eeprom)) {
+        // a range of a page does not continue into the lower page, and
+        // SFP A0h has no pages
+        return -1;
+    } else {
+        pos = base + PM_EEPROM_PAGE_SIZE * (page + 1) +
+              (offset - PM_EEPROM_PAGE_SIZE);
+    }
+
+    if (pos + len > size) {
+        return -1;
+    }
+
+    return pos;
+}
+
+//
+// pm_backend_port_bus: bus that transactions for a port are charged to.
+//                      Signal registers may sit on a CPLD elsewhere, but
+//                      the module eeprom's bus is the one whose load
+//                      matters. Also resolves the eeprom's mux path.
+//
+pm_bus_t *
+pm_backend_port_bus(pm_port_t *port)
+{
+    const YamlDevice *device;
+
+    if (NULL == port->bus) {
+        device = yaml_find_device(global_yaml_handle, port->subsystem,
+                                  port->module_device->module_eeprom);
+        port->bus = pm_bus_get((NULL != device && NULL != device->bus) ?
+                               device->bus : "unknown");
+        free(port->mux_path);
+        port->mux_path = pm_bus_mux_path(device);
+    }
+
+    return port->bus;
+}
+
+void
+pm_backend_port_destroy(pm_port_t *port)
+{
+    if (NULL != pm_backend->port_destroy) {
+        pm_backend->port_destroy(port);
+    }
+    free(port->mux_path);
+    port->mux_path = NULL;
+}
+
+int
+pm_backend_presence(pm_port_t *port, bool *present)
+{
+    long long int start = pm_bus_usec();
+    int rc;
+
+    rc = pm_backend->presence(port, present);
+    pm_bus_account(pm_backend_port_bus(port), 1, start);
+
+    return rc;
+}
+
+int
+pm_backend_read(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+                size_t offset, size_t len, unsigned char *data)
+{
+    pm_bus_t *bus = pm_backend_port_bus(port);
+    long long int start;
+    int rc;
+
+    if (!pm_bus_usable(bus)) {
+        return -1;
+    }
+
+    pm_bus_op_begin(bus);
+    start = pm_bus_usec();
+    pm_bus_select(bus, port->mux_path);
+    rc = pm_backend->read(port, eeprom, page, offset, len, data);
+    pm_bus_account(bus, len, start);
+    pm_bus_complete(bus, port->instance, pm_bus_op_usec(bus, start), rc);
+
+    return rc;
+}
+
+int
+pm_backend_write(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+                 size_t offset, size_t len, const unsigned char *data)
+{
+    pm_bus_t *bus = pm_backend_port_bus(port);
+    long long int start;
+    int rc;
+
+    if (!pm_bus_usable(bus)) {
+        return -1;
+    }
+
+    pm_bus_op_begin(bus);
+    start = pm_bus_usec();
+    pm_bus_select(bus, port->mux_path);
+    rc = pm_backend->write(port, eeprom, page, offset, len, data);
+    pm_bus_account(bus, len, start);
+    pm_bus_complete(bus, port->instance, pm_bus_op_usec(bus, start), rc);
+
+    return rc;
+}
+
+int
+pm_backend_reset(pm_port_t *port, bool asserted)
+{
+    long long int start = pm_bus_usec();
+    int rc;
+
+    rc = pm_backend->reset(port, asserted);
+    pm_bus_account(pm_backend_port_bus(port), 1, start);
+
+    return rc;
+}
+
+int
+pm_backend_tx_disable(pm_port_t *port, uint8_t mask)
+{
+    long long int start = pm_bus_usec();
+    int rc;
+
+    rc = pm_backend->tx_disable(port, mask);
+    pm_bus_account(pm_backend_port_bus(port), 1, start);
+
+    return rc;
+}
+
+void
+pm_backend_sweep_end(void)
+{
+    if (NULL != pm_backend->sweep_end) {
+        pm_backend->sweep_end();
+    }
+}
+
+//
+// pm_backend_batched: tell whether the backend overlaps batched reads;
+//                     batching is pointless otherwise
+//
+bool
+pm_backend_batched(void)
+{
+    return NULL != pm_backend->read_batch;
+}
+
+//
+// pm_backend_paged: tell whether a port's upper pages are reached by page
+//                   number, without page selects
+//
+bool
+pm_backend_paged(const pm_port_t *port)
+{
+    return NULL != pm_backend->paged && pm_backend->paged(port);
+}
+
+//
+// pm_backend_presence_batch: check presence of several ports at once
+//
+// input: ports, count, arrays for each port's presence and result
+//
+// output: none
+//
+void
+pm_backend_presence_batch(pm_port_t *ports[], size_t n, bool present[],
+                          int rc[])
+{
+    long long int start;
+    long long int usec;
+    size_t idx;
+
+    if (NULL == pm_backend->presence_batch) {
+        for (idx = 0; idx < n; idx++) {
+            rc[idx] = pm_backend_presence(ports[idx], &present[idx]);
+        }
+        return;
+    }
+
+    if (0 == n) {
+        return;
+    }
+
+    start = pm_bus_usec();
+    pm_backend->presence_batch(ports, n, present, rc);
+
+    // the checks overlapped, so each bus gets an equal share of the time
+    usec = (pm_bus_usec() - start) / n;
+    for (idx = 0; idx < n; idx++) {
+        pm_bus_charge(pm_backend_port_bus(ports[idx]), 1, usec);
+    }
+}
+
+//
+// pm_backend_read_batch: perform several reads at once. Callers leave out
+//                        ports of quarantined buses (pm_bus_usable).
+//
+// input: requests, count
+//
+// output: none; each request's rc is set
+//
+void
+pm_backend_read_batch(struct pm_backend_req *reqs, size_t n)
+{
+    long long int start;
+    long long int elapsed;
+    long long int usec;
+    size_t idx;
+
+    if (NULL == pm_backend->read_batch) {
+        for (idx = 0; idx < n; idx++) {
+            reqs[idx].rc = pm_backend_read(reqs[idx].port, reqs[idx].eeprom,
+                                           reqs[idx].page, reqs[idx].offset,
+                                           reqs[idx].len, reqs[idx].data);
+        }
+        return;
+    }
+
+    if (0 == n) {
+        return;
+    }
+
+    for (idx = 0; idx < n; idx++) {
+        pm_bus_t *bus = pm_backend_port_bus(reqs[idx].port);
+
+        pm_bus_op_begin(bus);
+        pm_bus_select(bus, reqs[idx].port->mux_path);
+    }
+
+    start = pm_bus_usec();
+    pm_backend->read_batch(reqs, n);
+
+    elapsed = pm_bus_usec() - start;
+    usec = elapsed / n;
+    for (idx = 0; idx < n; idx++) {
+        pm_bus_t *bus = pm_backend_port_bus(reqs[idx].port);
+
+        pm_bus_charge(bus, reqs[idx].len, usec);
+        // the operations overlap, so only a failed one may have been late
+        pm_bus_complete(bus, reqs[idx].port->instance,
+                        reqs[idx].rc != 0 ? elapsed : 0, reqs[idx].rc);
+    }
+}
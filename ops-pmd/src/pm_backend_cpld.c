@@ -0,0 +1,489 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the memory-mapped CPLD hardware access backend.
+ *
+ * Many platforms expose the CPLD holding the module presence, reset and
+ * tx disable bits over PCIe or LPC through UIO. --backend=cpld:MAPPING
+ * maps those register windows once and accesses the ports.yaml signals
+ * with plain loads and read-modify-write stores instead of I2C
+ * transactions. MAPPING is either a single file, used for every signal,
+ * or a comma separated list of DEVICE=FILE pairs naming the devices.yaml
+ * device each window belongs to:
+ *
+ *     --backend=cpld:/dev/uio0
+ *     --backend=cpld:port_cpld_1=/dev/uio0,port_cpld_2=/dev/uio1
+ *
+ * A register_address is the offset in the window. The window size of a
+ * UIO device comes from sysfs; any other file, e.g. a plain file standing
+ * in for the CPLD in tests, is mapped in full. Signals on devices that are
+ * not mapped, and all EEPROM access, go through the i2c backend.
+ *
+ * A register usually holds the bits of several ports, and other platform
+ * daemons may write it too. Atomic instructions cannot be used on device
+ * memory, so each read-modify-write is done with plain accesses under an
+ * advisory lock: flock() on the mapped file. Any process writing the same
+ * window takes that lock around its own read-modify-write. Within pmd
+ * the registers are only accessed from the main thread.
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <shash.h>
+#include <timeval.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "plug.h"
+#include "pm_backend.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_backend_cpld);
+
+extern YamlConfigHandle global_yaml_handle;
+
+// Name of the window used for every device, when MAPPING is a single file
+#define PM_CPLD_ANY_DEVICE  "*"
+
+// one mapped register window
+struct pm_cpld_window {
+    char            *path;
+    int             fd;                 // kept open for the lock
+    volatile uint8_t *base;
+    size_t          size;
+};
+
+static struct shash pm_cpld_windows = SHASH_INITIALIZER(&pm_cpld_windows);
+
+//
+// pm_cpld_window_size: size of the region to map. UIO devices report it
+//                      for each map; other files are mapped in full.
+//
+static int
+pm_cpld_window_size(const char *path, int fd, size_t *size)
+{
+    unsigned long long value;
+    struct stat st;
+    char    *sysfs;
+    FILE    *fp;
+    int     rc = -1;
+
+    if (0 == strncmp(path, "/dev/uio", strlen("/dev/uio"))) {
+        sysfs = xasprintf("/sys/class/uio/%s/maps/map0/size",
+                          path + strlen("/dev/"));
+        fp = fopen(sysfs, "r");
+        if (NULL != fp) {
+            if (1 == fscanf(fp, "%llx", &value)) {
+                *size = value;
+                rc = 0;
+            }
+            fclose(fp);
+        }
+        free(sysfs);
+        return rc;
+    }
+
+    if (0 != fstat(fd, &st)) {
+        return -1;
+    }
+    *size = st.st_size;
+
+    return 0;
+}
+
+static int
+pm_cpld_map(const char *device, const char *path)
+{
+    struct pm_cpld_window *window;
+    size_t  size;
+    void    *base;
+    int     fd;
+
+    fd = open(path, O_RDWR | O_SYNC | O_CLOEXEC);
+    if (fd < 0) {
+        VLOG_ERR("unable to open %s (%s)", path, ovs_strerror(errno));
+        return -1;
+    }
+
+    if (0 != pm_cpld_window_size(path, fd, &size) || 0 == size) {
+        VLOG_ERR("unable to find the register window size of %s", path);
+        close(fd);
+        return -1;
+    }
+
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == base) {
+        VLOG_ERR("unable to map %s (%s)", path, ovs_strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    window = xzalloc(sizeof(*window));
+    window->path = xstrdup(path);
+    window->fd = fd;
+    window->base = base;
+    window->size = size;
+
+    if (!shash_add_once(&pm_cpld_windows, device, window)) {
+        VLOG_ERR("device %s is mapped more than once", device);
+        munmap(base, size);
+        close(fd);
+        free(window->path);
+        free(window);
+        return -1;
+    }
+
+    VLOG_INFO("mapped %"PRIuSIZE" bytes of %s for %s", size, path,
+              strcmp(device, PM_CPLD_ANY_DEVICE) ? device : "all devices");
+
+    return 0;
+}
+
+static int
+pm_cpld_init(const char *arg)
+{
+    char    *copy;
+    char    *save_ptr = NULL;
+    char    *entry;
+    char    *equals;
+    int     rc = 0;
+
+    if (NULL == arg) {
+        VLOG_ERR("cpld backend needs a register file: "
+                 "--backend=cpld:FILE or cpld:DEVICE=FILE[,...]");
+        return -1;
+    }
+
+    if (NULL == strchr(arg, '=')) {
+        return pm_cpld_map(PM_CPLD_ANY_DEVICE, arg);
+    }
+
+    copy = xstrdup(arg);
+    for (entry = strtok_r(copy, ",", &save_ptr); NULL != entry;
+         entry = strtok_r(NULL, ",", &save_ptr)) {
+        equals = strchr(entry, '=');
+        if (NULL == equals || equals == entry) {
+            VLOG_ERR("cpld mapping \"%s\" is not DEVICE=FILE", entry);
+            rc = -1;
+            continue;
+        }
+        *equals = '\0';
+        if (0 != pm_cpld_map(entry, equals + 1)) {
+            rc = -1;
+        }
+    }
+    free(copy);
+
+    return rc;
+}
+
+//
+// pm_cpld_register: find the mapped register behind a signal
+//
+// input: signal, register width and window to fill in
+//
+// output: register address, or NULL if the signal is not mapped
+//
+static volatile void *
+pm_cpld_register(const i2c_bit_op *reg_op, size_t *width,
+                 struct pm_cpld_window **windowp)
+{
+    struct pm_cpld_window *window;
+
+    window = shash_find_data(&pm_cpld_windows, reg_op->device);
+    if (NULL == window) {
+        window = shash_find_data(&pm_cpld_windows, PM_CPLD_ANY_DEVICE);
+    }
+    if (NULL == window) {
+        return NULL;
+    }
+
+    // register_size is given in bytes or, on some platforms, in bits
+    switch (reg_op->register_size) {
+    case 0:
+    case 1:
+    case 8:
+        *width = 1;
+        break;
+    case 2:
+    case 16:
+        *width = 2;
+        break;
+    case 4:
+    case 32:
+        *width = 4;
+        break;
+    default:
+        return NULL;
+    }
+
+    if (reg_op->register_address % *width != 0 ||
+        reg_op->register_address + *width > window->size) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_WARN_RL(&rl, "register 0x%x of %s is outside %s",
+                     reg_op->register_address, reg_op->device, window->path);
+        return NULL;
+    }
+
+    *windowp = window;
+    return window->base + reg_op->register_address;
+}
+
+//
+// pm_cpld_lock: take the advisory lock of a window, polling rather than
+//               blocking so a stuck holder cannot hang pmd
+//
+// output: 0 on success, -1 if another process kept it for
+//         PM_BUS_LOCK_TIMEOUT msecs
+//
+static int
+pm_cpld_lock(const struct pm_cpld_window *window)
+{
+    long long int deadline = time_msec() + PM_BUS_LOCK_TIMEOUT;
+
+    while (0 != flock(window->fd, LOCK_EX | LOCK_NB)) {
+        if (EWOULDBLOCK != errno && EINTR != errno) {
+            // no locking on this file: nothing to serialize with
+            return 0;
+        }
+        if (time_msec() >= deadline) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+            VLOG_WARN_RL(&rl, "%s has been locked by another process for "
+                         "%dms", window->path, PM_BUS_LOCK_TIMEOUT);
+            return -1;
+        }
+        xnanosleep(100 * 1000);
+    }
+
+    return 0;
+}
+
+//
+// pm_cpld_reg_read: read a signal, the same way i2c_reg_read reports it:
+//                   masked, and inverted for active-low signals
+//
+static int
+pm_cpld_reg_read(pm_port_t *port, const i2c_bit_op *reg_op, uint32_t *value)
+{
+    struct pm_cpld_window *window;
+    volatile void *reg;
+    uint32_t    raw;
+    size_t      width;
+
+    reg = pm_cpld_register(reg_op, &width, &window);
+    if (NULL == reg) {
+        return i2c_reg_read(global_yaml_handle, port->subsystem, reg_op,
+                            value);
+    }
+
+    switch (width) {
+    case 1:
+        raw = *(volatile uint8_t *)reg;
+        break;
+    case 2:
+        raw = *(volatile uint16_t *)reg;
+        break;
+    default:
+        raw = *(volatile uint32_t *)reg;
+        break;
+    }
+
+    *value = raw & reg_op->bit_mask;
+    if (reg_op->negative_polarity) {
+        *value ^= reg_op->bit_mask;
+    }
+
+    return 0;
+}
+
+//
+// pm_cpld_reg_write: set the masked bits of a signal to value, leaving the
+//                    other bits of the register, which belong to other
+//                    ports, untouched. The read-modify-write is done
+//                    under the window lock.
+//
+// output: 0 on success, -1 if the lock could not be taken
+//
+static int
+pm_cpld_reg_write(pm_port_t *port, const i2c_bit_op *reg_op, uint32_t value)
+{
+    struct pm_cpld_window *window;
+    volatile void *reg;
+    uint32_t    bits = value & reg_op->bit_mask;
+    size_t      width;
+
+    reg = pm_cpld_register(reg_op, &width, &window);
+    if (NULL == reg) {
+        return i2c_reg_write(global_yaml_handle, port->subsystem, reg_op,
+                             value);
+    }
+
+    if (reg_op->negative_polarity) {
+        bits ^= reg_op->bit_mask;
+    }
+
+    if (0 != pm_cpld_lock(window)) {
+        return -1;
+    }
+
+#define PM_CPLD_RMW(TYPE)                                                   \
+    do {                                                                    \
+        volatile TYPE *r = reg;                                             \
+                                                                            \
+        *r = (*r & ~(TYPE)reg_op->bit_mask) | (TYPE)bits;                   \
+    } while (0)
+
+    switch (width) {
+    case 1:
+        PM_CPLD_RMW(uint8_t);
+        break;
+    case 2:
+        PM_CPLD_RMW(uint16_t);
+        break;
+    default:
+        PM_CPLD_RMW(uint32_t);
+        break;
+    }
+
+#undef PM_CPLD_RMW
+
+    flock(window->fd, LOCK_UN);
+
+    return 0;
+}
+
+static const i2c_bit_op *
+pm_cpld_presence_signal(const pm_port_t *port)
+{
+    const YamlPort *device = port->module_device;
+
+    if (0 == strcmp(device->connector, CONNECTOR_SFP_PLUS)) {
+        return device->module_signals.sfp.sfpp_mod_present;
+    } else if (0 == strcmp(device->connector, CONNECTOR_QSFP_PLUS)) {
+        return device->module_signals.qsfp.qsfpp_mod_present;
+    } else if (0 == strcmp(device->connector, CONNECTOR_QSFP28) ||
+               NULL != port->cmis) {
+        // CMIS cages keep the QSFP28 module signals
+        return device->module_signals.qsfp28.qsfp28p_mod_present;
+    }
+
+    return NULL;
+}
+
+static int
+pm_cpld_presence(pm_port_t *port, bool *present)
+{
+    const i2c_bit_op *reg_op = pm_cpld_presence_signal(port);
+    uint32_t    result;
+    int         rc;
+
+    if (NULL == reg_op) {
+        return -1;
+    }
+
+    rc = pm_cpld_reg_read(port, reg_op, &result);
+    if (0 == rc) {
+        *present = (result != 0);
+    }
+
+    return rc;
+}
+
+static int
+pm_cpld_read(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+             size_t offset, size_t len, unsigned char *data)
+{
+    return pm_backend_i2c.read(port, eeprom, page, offset, len, data);
+}
+
+static int
+pm_cpld_write(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+              size_t offset, size_t len, const unsigned char *data)
+{
+    return pm_backend_i2c.write(port, eeprom, page, offset, len, data);
+}
+
+static void
+pm_cpld_sweep_end(void)
+{
+    pm_backend_i2c.sweep_end();
+}
+
+static int
+pm_cpld_reset(pm_port_t *port, bool asserted)
+{
+    const i2c_bit_op *reg_op = NULL;
+
+    if (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP_PLUS)) {
+        reg_op = port->module_device->module_signals.qsfp.qsfpp_reset;
+    } else if (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP28) ||
+               NULL != port->cmis) {
+        reg_op = port->module_device->module_signals.qsfp28.qsfp28p_reset;
+    }
+
+    if (NULL == reg_op) {
+        VLOG_DBG("port %s does does not have a reset", port->instance);
+        return 0;
+    }
+
+    return pm_cpld_reg_write(port, reg_op, asserted ? 0xffu : 0);
+}
+
+static int
+pm_cpld_tx_disable(pm_port_t *port, uint8_t mask)
+{
+    const i2c_bit_op *reg_op;
+
+    // QSFP lanes are disabled through the eeprom
+    if (0 != strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
+        return pm_backend_i2c.tx_disable(port, mask);
+    }
+
+    reg_op = port->module_device->module_signals.sfp.sfpp_tx_disable;
+    if (NULL == reg_op) {
+        return -1;
+    }
+
+    return pm_cpld_reg_write(port, reg_op, mask ? reg_op->bit_mask : 0);
+}
+
+const struct pm_backend_class pm_backend_cpld = {
+    .name = "cpld",
+    .arg_usage = "register file (e.g. /dev/uio0) or DEVICE=FILE[,...]",
+    .init = pm_cpld_init,
+    .port_destroy = NULL,
+    .presence = pm_cpld_presence,
+    .read = pm_cpld_read,
+    .write = pm_cpld_write,
+    .reset = pm_cpld_reset,
+    .tx_disable = pm_cpld_tx_disable,
+    .sweep_end = pm_cpld_sweep_end,
+};
@@ -0,0 +1,166 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the file hardware access backend.
+ *
+ * --backend=file:DIR treats DIR/<interface> as the EEPROM image of the
+ * module in that interface: the module is present while the file exists.
+ * Images are read afresh on every access, so they can be swapped while
+ * the daemon runs. See pm_backend_image_offset() for the layout. Module
+ * signals (reset, tx disable) are not modelled.
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <util.h>
+
+#include "pmd.h"
+#include "pm_backend.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_backend_file);
+
+static char *pm_file_dir = NULL;
+
+static int
+pm_file_init(const char *arg)
+{
+    struct stat st;
+
+    if (NULL == arg || 0 != stat(arg, &st) || !S_ISDIR(st.st_mode)) {
+        VLOG_ERR("file backend needs a directory: --backend=file:DIR");
+        return -1;
+    }
+
+    pm_file_dir = xstrdup(arg);
+
+    return 0;
+}
+
+static char *
+pm_file_path(const pm_port_t *port)
+{
+    return xasprintf("%s/%s", pm_file_dir, port->instance);
+}
+
+static int
+pm_file_presence(pm_port_t *port, bool *present)
+{
+    char *path = pm_file_path(port);
+
+    *present = (0 == access(path, R_OK));
+    free(path);
+
+    return 0;
+}
+
+//
+// pm_file_io: read or write a range of the port's image
+//
+static int
+pm_file_io(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+           size_t offset, size_t len, unsigned char *data, bool write)
+{
+    struct stat st;
+    char        *path = pm_file_path(port);
+    ssize_t     n = -1;
+    off_t       pos;
+    int         fd;
+
+    fd = open(path, write ? O_RDWR : O_RDONLY);
+    free(path);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (0 == fstat(fd, &st)) {
+        pos = pm_backend_image_offset(port, st.st_size, eeprom, page, offset,
+                                      len);
+        if (pos >= 0) {
+            n = write ? pwrite(fd, data, len, pos) : pread(fd, data, len, pos);
+        }
+    }
+    close(fd);
+
+    return (n == (ssize_t)len) ? 0 : -1;
+}
+
+static int
+pm_file_read(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+             size_t offset, size_t len, unsigned char *data)
+{
+    return pm_file_io(port, eeprom, page, offset, len, data, false);
+}
+
+static int
+pm_file_write(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+              size_t offset, size_t len, const unsigned char *data)
+{
+    return pm_file_io(port, eeprom, page, offset, len, (unsigned char *)data,
+                      true);
+}
+
+//
+// pm_file_paged: images larger than an eeprom space hold upper pages by
+//                page number, as optoe does
+//
+static bool
+pm_file_paged(const pm_port_t *port)
+{
+    struct stat st;
+    char        *path = pm_file_path(port);
+    bool        paged;
+
+    paged = (0 == stat(path, &st) && st.st_size > PM_EEPROM_SPACE_SIZE);
+    free(path);
+
+    return paged;
+}
+
+static int
+pm_file_reset(pm_port_t *port OVS_UNUSED, bool asserted OVS_UNUSED)
+{
+    return 0;
+}
+
+static int
+pm_file_tx_disable(pm_port_t *port OVS_UNUSED, uint8_t mask OVS_UNUSED)
+{
+    return 0;
+}
+
+const struct pm_backend_class pm_backend_file = {
+    .name = "file",
+    .arg_usage = "directory holding one EEPROM image per interface",
+    .init = pm_file_init,
+    .port_destroy = NULL,
+    .presence = pm_file_presence,
+    .read = pm_file_read,
+    .write = pm_file_write,
+    .reset = pm_file_reset,
+    .tx_disable = pm_file_tx_disable,
+    .paged = pm_file_paged,
+};
@@ -0,0 +1,428 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the config-yaml I2C hardware access backend.
+ *
+ * Module signals are i2c_bit_op registers from ports.yaml; EEPROMs are
+ * devices from devices.yaml, with the SFP diagnostics page on the device
+ * named after the module eeprom with a "_dom" suffix.
+ *
+ * An EEPROM device behind muxes has pre operations selecting its leg and
+ * post operations deselecting it. Rather than letting i2c_data_read run
+ * both around every transfer, the backend runs them itself and keeps a
+ * per-bus shadow of the selected leg: consecutive transfers on the same
+ * leg skip the deselect and reselect. The muxes are deselected when the
+ * leg changes, after an error, and at the end of every sweep, so other
+ * users of the bus find them idle between sweeps.
+ *
+ * Each transfer, and each leg from select to deselect, is done under the
+ * bus's cross-process lock (see pm_bus_lock), as are signal register
+ * accesses. A transfer is timed against the deadline from when the lock
+ * is held (see pm_bus_transferred).
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+
+#include "pmd.h"
+#include "plug.h"
+#include "pm_backend.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_backend_i2c);
+
+extern YamlConfigHandle global_yaml_handle;
+
+#define MAX_DEVICE_NAME_LEN 1024
+
+static void pm_i2c_release(pm_bus_t *bus);
+
+//
+// pm_i2c_reg_begin: lock the bus of a signal register for its access. A
+//                   register behind muxes of its own selects them around
+//                   the access, so whatever leg the bus was left on must
+//                   be deselected first.
+//
+// input: port, signal, bus to fill in (NULL if unknown)
+//
+// output: 0 on success, -1 if the bus could not be locked
+//
+static int
+pm_i2c_reg_begin(const pm_port_t *port, const i2c_bit_op *reg_op,
+                 pm_bus_t **bus)
+{
+    const YamlDevice *device;
+
+    *bus = NULL;
+
+    if (NULL == reg_op) {
+        return 0;
+    }
+
+    device = yaml_find_device(global_yaml_handle, port->subsystem,
+                              reg_op->device);
+    if (NULL == device || NULL == device->bus) {
+        return 0;
+    }
+
+    *bus = pm_bus_get(device->bus);
+    if (NULL != device->pre && NULL != device->pre[0]) {
+        pm_i2c_release(*bus);
+    }
+
+    if (0 != pm_bus_lock(*bus)) {
+        *bus = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+pm_i2c_presence(pm_port_t *port, bool *present)
+{
+    i2c_bit_op  *reg_op;
+    pm_bus_t    *bus;
+    uint32_t    result;
+    int         rc;
+
+    if (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
+        reg_op = port->module_device->module_signals.sfp.sfpp_mod_present;
+    } else if (0 == strcmp(port->module_device->connector,
+                           CONNECTOR_QSFP_PLUS)) {
+        reg_op = port->module_device->module_signals.qsfp.qsfpp_mod_present;
+    } else if (0 == strcmp(port->module_device->connector,
+                           CONNECTOR_QSFP28) || NULL != port->cmis) {
+        // CMIS cages keep the QSFP28 module signals
+        reg_op = port->module_device->module_signals.qsfp28.qsfp28p_mod_present;
+    } else {
+        return -1;
+    }
+
+    rc = pm_i2c_reg_begin(port, reg_op, &bus);
+    if (0 != rc) {
+        return rc;
+    }
+    rc = i2c_reg_read(global_yaml_handle, port->subsystem, reg_op, &result);
+    pm_bus_unlock(bus);
+    if (0 == rc) {
+        *present = (result != 0);
+    }
+
+    return rc;
+}
+
+static const YamlDevice *
+pm_i2c_device(pm_port_t *port, enum pm_eeprom eeprom)
+{
+    char name[MAX_DEVICE_NAME_LEN];
+
+    if (PM_EEPROM_A2 == eeprom) {
+        snprintf(name, sizeof(name), "%s_dom",
+                 port->module_device->module_eeprom);
+        return yaml_find_device(global_yaml_handle, port->subsystem, name);
+    }
+
+    return yaml_find_device(global_yaml_handle, port->subsystem,
+                            port->module_device->module_eeprom);
+}
+
+static size_t
+pm_i2c_op_count(i2c_op **ops)
+{
+    size_t count = 0;
+
+    while (NULL != ops && NULL != ops[count]) {
+        count++;
+    }
+
+    return count;
+}
+
+static bool
+pm_i2c_op_equal(const i2c_op *a, const i2c_op *b)
+{
+    return a->direction == b->direction &&
+           a->register_address == b->register_address &&
+           a->byte_count == b->byte_count &&
+           a->set_register == b->set_register &&
+           a->negative_polarity == b->negative_polarity &&
+           0 == strcmp(a->device, b->device) &&
+           (0 == a->byte_count ||
+            0 == memcmp(a->data, b->data, a->byte_count));
+}
+
+//
+// pm_i2c_same_leg: tell whether two devices are selected by the same
+//                  mux operations
+//
+static bool
+pm_i2c_same_leg(const YamlDevice *a, const YamlDevice *b)
+{
+    size_t count = pm_i2c_op_count(a->pre);
+    size_t idx;
+
+    if (a == b) {
+        return true;
+    }
+    if (count != pm_i2c_op_count(b->pre)) {
+        return false;
+    }
+    for (idx = 0; idx < count; idx++) {
+        if (!pm_i2c_op_equal(a->pre[idx], b->pre[idx])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int
+pm_i2c_mux_execute(pm_bus_t *bus, const char *subsystem,
+                   const YamlDevice *device, i2c_op **ops)
+{
+    size_t count = pm_i2c_op_count(ops);
+
+    if (0 == count) {
+        return 0;
+    }
+
+    bus->current.mux_ops += count;
+
+    return i2c_execute(global_yaml_handle, subsystem, device, ops);
+}
+
+//
+// pm_i2c_release: deselect the mux leg a bus was left on, if any
+//
+static void
+pm_i2c_release(pm_bus_t *bus)
+{
+    if (NULL == bus->mux_owner) {
+        return;
+    }
+
+    // deselecting on a hung bus would only time out; the muxes are
+    // selected from scratch once it is back
+    if (!pm_bus_quarantined(bus) &&
+        0 != pm_i2c_mux_execute(bus, bus->mux_subsystem, bus->mux_owner,
+                                bus->mux_owner->post)) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_WARN_RL(&rl, "mux deselect failed on bus %s", bus->name);
+    }
+
+    pm_bus_set_mux_owner(bus, NULL, NULL);
+    pm_bus_unlock(bus);
+}
+
+//
+// pm_i2c_select: make sure a device's mux leg is selected, skipping the
+//                writes if the bus was left on that leg
+//
+static int
+pm_i2c_select(pm_bus_t *bus, const char *subsystem, const YamlDevice *device)
+{
+    int rc;
+
+    if (NULL != bus->mux_owner &&
+        0 == strcmp(bus->mux_subsystem, subsystem) &&
+        pm_i2c_same_leg(bus->mux_owner, device)) {
+        bus->current.mux_ops_saved += pm_i2c_op_count(bus->mux_owner->post) +
+                                      pm_i2c_op_count(device->pre);
+        // keep the deselect sequence of the device now using the leg
+        pm_bus_set_mux_owner(bus, device, subsystem);
+        return 0;
+    }
+
+    pm_i2c_release(bus);
+
+    if (0 == pm_i2c_op_count(device->pre) &&
+        0 == pm_i2c_op_count(device->post)) {
+        return 0;
+    }
+
+    // the leg keeps the bus locked until it is deselected
+    if (0 != pm_bus_lock(bus)) {
+        return -1;
+    }
+    pm_bus_set_mux_owner(bus, device, subsystem);
+
+    rc = pm_i2c_mux_execute(bus, subsystem, device, device->pre);
+    if (0 != rc) {
+        // a partial select leaves the muxes in an unknown state
+        pm_i2c_release(bus);
+        return rc;
+    }
+
+    return 0;
+}
+
+//
+// pm_i2c_transfer: read or write an eeprom range with the device's mux
+//                  operations taken care of by the mux shadow
+//
+static int
+pm_i2c_transfer(pm_port_t *port, enum pm_eeprom eeprom, size_t offset,
+                size_t len, unsigned char *data, bool write)
+{
+    const YamlDevice *device = pm_i2c_device(port, eeprom);
+    YamlDevice  direct;
+    pm_bus_t    *bus;
+    long long int start;
+    int         rc;
+
+    if (NULL == device) {
+        return -1;
+    }
+
+    bus = pm_bus_get(NULL != device->bus ? device->bus : "unknown");
+
+    if (0 != pm_bus_lock(bus)) {
+        return -1;
+    }
+    start = pm_bus_usec();
+
+    rc = pm_i2c_select(bus, port->subsystem, device);
+    if (0 != rc) {
+        pm_bus_transferred(bus, start);
+        pm_bus_unlock(bus);
+        return rc;
+    }
+
+    // the same device, with the mux operations already done
+    direct = *device;
+    direct.pre = NULL;
+    direct.post = NULL;
+
+    if (write) {
+        rc = i2c_data_write(global_yaml_handle, &direct, port->subsystem,
+                            offset, len, data);
+    } else {
+        rc = i2c_data_read(global_yaml_handle, &direct, port->subsystem,
+                           offset, len, data);
+    }
+
+    if (0 != rc) {
+        pm_i2c_release(bus);
+    }
+    pm_bus_transferred(bus, start);
+    pm_bus_unlock(bus);
+
+    return rc;
+}
+
+// the module shows the page last selected, so the page is not used
+static int
+pm_i2c_read(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page OVS_UNUSED,
+            size_t offset, size_t len, unsigned char *data)
+{
+    return pm_i2c_transfer(port, eeprom, offset, len, data, false);
+}
+
+static int
+pm_i2c_write(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page OVS_UNUSED,
+             size_t offset, size_t len, const unsigned char *data)
+{
+    return pm_i2c_transfer(port, eeprom, offset, len,
+                           (unsigned char *)data, true);
+}
+
+static void
+pm_i2c_sweep_end(void)
+{
+    pm_bus_for_each(pm_i2c_release);
+}
+
+static int
+pm_i2c_reset(pm_port_t *port, bool asserted)
+{
+    i2c_bit_op *reg_op = NULL;
+    pm_bus_t   *bus;
+    int        rc;
+
+    if (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP_PLUS)) {
+        reg_op = port->module_device->module_signals.qsfp.qsfpp_reset;
+    } else if (0 == strcmp(port->module_device->connector, CONNECTOR_QSFP28) ||
+               NULL != port->cmis) {
+        reg_op = port->module_device->module_signals.qsfp28.qsfp28p_reset;
+    }
+
+    if (NULL == reg_op) {
+        VLOG_DBG("port %s does does not have a reset", port->instance);
+        return 0;
+    }
+
+    rc = pm_i2c_reg_begin(port, reg_op, &bus);
+    if (0 != rc) {
+        return rc;
+    }
+    rc = i2c_reg_write(global_yaml_handle, port->subsystem, reg_op,
+                       asserted ? 0xffu : 0);
+    pm_bus_unlock(bus);
+
+    return rc;
+}
+
+//
+// pm_i2c_tx_disable: SFPs have a tx disable signal; QSFPs are disabled
+//                    per lane through the module eeprom
+//
+static int
+pm_i2c_tx_disable(pm_port_t *port, uint8_t mask)
+{
+    i2c_bit_op *reg_op;
+    pm_bus_t   *bus;
+    int        rc;
+
+    if (0 != strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
+        return pm_i2c_write(port, PM_EEPROM_A0, 0, QSFP_DISABLE_OFFSET,
+                            sizeof(mask), &mask);
+    }
+
+    reg_op = port->module_device->module_signals.sfp.sfpp_tx_disable;
+    if (NULL == reg_op) {
+        return -1;
+    }
+
+    rc = pm_i2c_reg_begin(port, reg_op, &bus);
+    if (0 != rc) {
+        return rc;
+    }
+    rc = i2c_reg_write(global_yaml_handle, port->subsystem, reg_op,
+                       mask ? reg_op->bit_mask : 0);
+    pm_bus_unlock(bus);
+
+    return rc;
+}
+
+const struct pm_backend_class pm_backend_i2c = {
+    .name = "i2c",
+    .arg_usage = NULL,
+    .init = NULL,
+    .port_destroy = NULL,
+    .presence = pm_i2c_presence,
+    .read = pm_i2c_read,
+    .write = pm_i2c_write,
+    .reset = pm_i2c_reset,
+    .tx_disable = pm_i2c_tx_disable,
+    .sweep_end = pm_i2c_sweep_end,
+};
@@ -0,0 +1,249 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the simulation hardware access backend.
+ *
+ * Modules are inserted and removed with
+ *     ovs-appctl -t ops-pmd ops-pmd/sim <interface> insert <file>
+ *     ovs-appctl -t ops-pmd ops-pmd/sim <interface> remove
+ * where <file> holds the 128 byte serial ID block of the module. There is
+ * no diagnostics page; writes are accepted and discarded.
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <shash.h>
+#include <unixctl.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "plug.h"
+#include "pm_backend.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_backend_sim);
+
+extern struct shash ovs_intfs;
+
+// simulated module state, hung off pm_port_t's backend_data
+struct pm_sim_port {
+    unsigned char   *module_data;       // serial ID block, NULL if absent
+    uint8_t         tx_disable;
+    bool            reset;
+};
+
+static struct pm_sim_port *
+pm_sim_port(pm_port_t *port)
+{
+    if (NULL == port->backend_data) {
+        port->backend_data = xzalloc(sizeof(struct pm_sim_port));
+    }
+
+    return port->backend_data;
+}
+
+static int
+pmd_sim_insert(const char *name, const char *file, struct ds *ds)
+{
+    struct shash_node *node;
+    struct pm_sim_port *sim;
+    FILE *fp;
+    unsigned char *data;
+
+    node = shash_find(&ovs_intfs, name);
+    if (NULL == node) {
+        ds_put_cstr(ds, "No such interface");
+        return -1;
+    }
+    sim = pm_sim_port((pm_port_t *)node->data);
+
+    free(sim->module_data);
+    sim->module_data = NULL;
+
+    fp = fopen(file, "r");
+
+    if (NULL == fp) {
+        ds_put_cstr(ds, "Can't open file");
+        return -1;
+    }
+
+    data = xmalloc(sizeof(pm_sfp_serial_id_t));
+
+    if (1 != fread(data, sizeof(pm_sfp_serial_id_t), 1, fp)) {
+        ds_put_cstr(ds, "Unable to read data");
+        free(data);
+        fclose(fp);
+        return -1;
+    }
+
+    fclose(fp);
+
+    sim->module_data = data;
+
+    ds_put_cstr(ds, "Pluggable module inserted");
+
+    return 0;
+}
+
+static int
+pmd_sim_remove(const char *name, struct ds *ds)
+{
+    struct shash_node *node;
+    struct pm_sim_port *sim;
+
+    node = shash_find(&ovs_intfs, name);
+    if (NULL == node) {
+        ds_put_cstr(ds, "No such interface");
+        return -1;
+    }
+    sim = pm_sim_port((pm_port_t *)node->data);
+
+    if (NULL == sim->module_data) {
+        ds_put_cstr(ds, "Pluggable module not present");
+        return -1;
+    }
+
+    free(sim->module_data);
+    sim->module_data = NULL;
+
+    ds_put_cstr(ds, "Pluggable module removed");
+    return 0;
+}
+
+static void
+pmd_unixctl_sim(struct unixctl_conn *conn, int argc,
+                const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    int rc = 0;
+    const char *interface = argv[1];
+
+    /* usage:
+        ops-pmd/sim <interface> insert <file>
+        ops-pmd/sim <interface> remove
+    */
+    if (4 == argc && strcmp("insert", argv[2]) == 0) {
+        rc = pmd_sim_insert(interface, argv[3], &ds);
+    } else if (3 == argc && strcmp("remove", argv[2]) == 0) {
+        rc = pmd_sim_remove(interface, &ds);
+    } else {
+        rc = -1;
+        ds_put_cstr(&ds, "Invalid usage: ... ops-pmd/sim <interface> [insert <file> | remove]");
+    }
+
+    if (rc < 0) {
+        unixctl_command_reply_error(conn, ds_cstr(&ds));
+    } else {
+        unixctl_command_reply(conn, ds_cstr(&ds));
+    }
+
+    ds_destroy(&ds);
+}
+
+static int
+pm_sim_init(const char *arg OVS_UNUSED)
+{
+    unixctl_command_register("ops-pmd/sim", "", 2, 3,
+                             pmd_unixctl_sim, NULL);
+    return 0;
+}
+
+static void
+pm_sim_port_destroy(pm_port_t *port)
+{
+    struct pm_sim_port *sim = port->backend_data;
+
+    if (NULL != sim) {
+        free(sim->module_data);
+        free(sim);
+        port->backend_data = NULL;
+    }
+}
+
+static int
+pm_sim_presence(pm_port_t *port, bool *present)
+{
+    *present = (NULL != pm_sim_port(port)->module_data);
+    return 0;
+}
+
+//
+// pm_sim_read: only the serial ID block exists; it sits at the start of
+//              the SFP A0 page and in the upper page of QSFPs
+//
+static int
+pm_sim_read(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+            size_t offset, size_t len, unsigned char *data)
+{
+    struct pm_sim_port *sim = pm_sim_port(port);
+    off_t pos;
+
+    if (NULL == sim->module_data) {
+        return -1;
+    }
+
+    pos = pm_backend_image_offset(port, sizeof(pm_sfp_serial_id_t), eeprom,
+                                  page, offset, len);
+    if (pos < 0) {
+        return -1;
+    }
+
+    memcpy(data, sim->module_data + pos, len);
+
+    return 0;
+}
+
+static int
+pm_sim_write(pm_port_t *port OVS_UNUSED, enum pm_eeprom eeprom OVS_UNUSED,
+             uint8_t page OVS_UNUSED, size_t offset OVS_UNUSED,
+             size_t len OVS_UNUSED, const unsigned char *data OVS_UNUSED)
+{
+    return 0;
+}
+
+static int
+pm_sim_reset(pm_port_t *port, bool asserted)
+{
+    pm_sim_port(port)->reset = asserted;
+    return 0;
+}
+
+static int
+pm_sim_tx_disable(pm_port_t *port, uint8_t mask)
+{
+    pm_sim_port(port)->tx_disable = mask;
+    return 0;
+}
+
+const struct pm_backend_class pm_backend_sim = {
+    .name = "sim",
+    .arg_usage = NULL,
+    .init = pm_sim_init,
+    .port_destroy = pm_sim_port_destroy,
+    .presence = pm_sim_presence,
+    .read = pm_sim_read,
+    .write = pm_sim_write,
+    .reset = pm_sim_reset,
+    .tx_disable = pm_sim_tx_disable,
+};
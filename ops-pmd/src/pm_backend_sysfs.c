@@ -0,0 +1,411 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the kernel EEPROM (optoe/at24 sysfs) hardware access
+ * backend.
+ *
+ * --backend=sysfs:MAPFILE reads module EEPROMs through the files the
+ * kernel exposes, e.g. /sys/bus/i2c/devices/11-0050/eeprom, and leaves
+ * paging and caching to the driver. Each MAPFILE line is
+ *
+ *     <interface> <eeprom file> [<A2h file>]
+ *
+ * Blank lines and lines starting with '#' are ignored. optoe files hold
+ * the SFP A2h space after A0h; with at24, give the 0x51 device's file as
+ * the third field. Files are opened on first use and kept open.
+ *
+ * optoe files are larger than an eeprom space and hold every upper page
+ * at its own position (see pm_backend_image_offset()), so upper pages
+ * are read by page number and no page select is ever written; the driver
+ * does the paging. at24 files show the page the module has selected.
+ *
+ * A module is present when its EEPROM can be read. Reset and the SFP tx
+ * disable signal are not reachable through the EEPROM and are handled by
+ * the i2c backend.
+ *
+ * File access goes through pm_io, so the reads of a sweep are batched and
+ * overlap in the kernel.
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <shash.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "plug.h"
+#include "pm_backend.h"
+#include "pm_io.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_backend_sysfs);
+
+// one open eeprom file
+struct pm_sysfs_file {
+    char    *path;
+    int     fd;                         // -1 until opened
+    size_t  size;                       // as reported by fstat
+};
+
+// entry of the map file, also hung off pm_port_t's backend_data
+struct pm_sysfs_port {
+    struct pm_sysfs_file a0;
+    struct pm_sysfs_file a2;            // path is NULL with optoe
+};
+
+static struct shash pm_sysfs_ports = SHASH_INITIALIZER(&pm_sysfs_ports);
+
+static int
+pm_sysfs_init(const char *arg)
+{
+    struct pm_sysfs_port *entry;
+    char    line[1024];
+    char    name[256];
+    char    a0[512];
+    char    a2[512];
+    int     lineno = 0;
+    int     fields;
+    FILE    *fp;
+
+    if (NULL == arg) {
+        VLOG_ERR("sysfs backend needs a map file: --backend=sysfs:MAPFILE");
+        return -1;
+    }
+
+    fp = fopen(arg, "r");
+    if (NULL == fp) {
+        VLOG_ERR("unable to open %s (%s)", arg, ovs_strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        lineno++;
+
+        fields = sscanf(line, "%255s %511s %511s", name, a0, a2);
+        if (fields < 1 || '#' == name[0]) {
+            continue;
+        }
+        if (fields < 2) {
+            VLOG_WARN("%s:%d: no eeprom file for %s", arg, lineno, name);
+            continue;
+        }
+
+        entry = xzalloc(sizeof(*entry));
+        entry->a0.path = xstrdup(a0);
+        entry->a0.fd = -1;
+        entry->a2.path = (3 == fields) ? xstrdup(a2) : NULL;
+        entry->a2.fd = -1;
+
+        if (!shash_add_once(&pm_sysfs_ports, name, entry)) {
+            VLOG_WARN("%s:%d: duplicate entry for %s", arg, lineno, name);
+            free(entry->a0.path);
+            free(entry->a2.path);
+            free(entry);
+        }
+    }
+
+    fclose(fp);
+
+    VLOG_INFO("%"PRIuSIZE" interfaces mapped to eeprom files",
+              shash_count(&pm_sysfs_ports));
+
+    return 0;
+}
+
+static struct pm_sysfs_port *
+pm_sysfs_port(pm_port_t *port)
+{
+    if (NULL == port->backend_data) {
+        port->backend_data = shash_find_data(&pm_sysfs_ports, port->instance);
+    }
+
+    return port->backend_data;
+}
+
+//
+// pm_sysfs_open: open a file on first use. A failed open is retried on
+//                the next access, since drivers may bind late.
+//
+static int
+pm_sysfs_open(struct pm_sysfs_file *file)
+{
+    struct stat st;
+
+    if (file->fd >= 0) {
+        return 0;
+    }
+
+    file->fd = open(file->path, O_RDWR | O_CLOEXEC);
+    if (file->fd < 0) {
+        file->fd = open(file->path, O_RDONLY | O_CLOEXEC);
+    }
+    if (file->fd < 0) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_WARN_RL(&rl, "unable to open %s (%s)", file->path,
+                     ovs_strerror(errno));
+        return -1;
+    }
+
+    file->size = (0 == fstat(file->fd, &st)) ? st.st_size : 0;
+
+    return 0;
+}
+
+//
+// pm_sysfs_locate: pick the file and position holding an eeprom range
+//
+static struct pm_sysfs_file *
+pm_sysfs_locate(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+                size_t offset, size_t len, off_t *pos)
+{
+    struct pm_sysfs_port *entry = pm_sysfs_port(port);
+    struct pm_sysfs_file *file;
+
+    if (NULL == entry) {
+        return NULL;
+    }
+
+    if (PM_EEPROM_A2 == eeprom && NULL != entry->a2.path) {
+        file = &entry->a2;
+        if (0 != pm_sysfs_open(file) || offset + len > file->size ||
+            (0 != page && offset + len > PM_EEPROM_PAGE_SIZE)) {
+            return NULL;
+        }
+        *pos = offset;
+        return file;
+    }
+
+    file = &entry->a0;
+    if (0 != pm_sysfs_open(file)) {
+        return NULL;
+    }
+
+    // at24 files show the selected page in place of page 00h
+    if (file->size <= PM_EEPROM_SPACE_SIZE) {
+        page = 0;
+    }
+
+    *pos = pm_backend_image_offset(port, file->size, eeprom, page, offset,
+                                   len);
+
+    return (*pos < 0) ? NULL : file;
+}
+
+static int
+pm_sysfs_read(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+              size_t offset, size_t len, unsigned char *data)
+{
+    struct pm_sysfs_file *file;
+    struct pm_io io;
+
+    file = pm_sysfs_locate(port, eeprom, page, offset, len, &io.pos);
+    if (NULL == file) {
+        return -1;
+    }
+
+    io.fd = file->fd;
+    io.buf = data;
+    io.len = len;
+    io.write = false;
+    pm_io_submit(&io, 1);
+
+    return (io.res == (ssize_t)len) ? 0 : -1;
+}
+
+static int
+pm_sysfs_write(pm_port_t *port, enum pm_eeprom eeprom, uint8_t page,
+               size_t offset, size_t len, const unsigned char *data)
+{
+    struct pm_sysfs_file *file;
+    struct pm_io io;
+
+    file = pm_sysfs_locate(port, eeprom, page, offset, len, &io.pos);
+    if (NULL == file) {
+        return -1;
+    }
+
+    io.fd = file->fd;
+    io.buf = CONST_CAST(unsigned char *, data);
+    io.len = len;
+    io.write = true;
+    pm_io_submit(&io, 1);
+
+    return (io.res == (ssize_t)len) ? 0 : -1;
+}
+
+//
+// pm_sysfs_read_batch: submit all reads of a batch together. Requests
+//                      whose file is unavailable fail without I/O.
+//
+static void
+pm_sysfs_read_batch(struct pm_backend_req *reqs, size_t n)
+{
+    struct pm_sysfs_file *file;
+    struct pm_io *ios = xmalloc(n * sizeof(*ios));
+    size_t *req_of = xmalloc(n * sizeof(*req_of));
+    size_t count = 0;
+    size_t idx;
+
+    for (idx = 0; idx < n; idx++) {
+        reqs[idx].rc = -1;
+
+        file = pm_sysfs_locate(reqs[idx].port, reqs[idx].eeprom,
+                               reqs[idx].page, reqs[idx].offset,
+                               reqs[idx].len, &ios[count].pos);
+        if (NULL == file) {
+            continue;
+        }
+
+        ios[count].fd = file->fd;
+        ios[count].buf = reqs[idx].data;
+        ios[count].len = reqs[idx].len;
+        ios[count].write = false;
+        req_of[count++] = idx;
+    }
+
+    pm_io_submit(ios, count);
+
+    for (idx = 0; idx < count; idx++) {
+        if (ios[idx].res == (ssize_t)ios[idx].len) {
+            reqs[req_of[idx]].rc = 0;
+        }
+    }
+
+    free(req_of);
+    free(ios);
+}
+
+//
+// pm_sysfs_presence_batch: the drivers fail reads from an empty cage, so
+//                          a one byte read tells whether a module is there
+//
+static void
+pm_sysfs_presence_batch(pm_port_t *ports[], size_t n, bool present[],
+                        int rc[])
+{
+    struct pm_sysfs_port *entry;
+    struct pm_io *ios = xmalloc(n * sizeof(*ios));
+    unsigned char *bytes = xmalloc(n);
+    size_t *port_of = xmalloc(n * sizeof(*port_of));
+    size_t count = 0;
+    size_t idx;
+
+    for (idx = 0; idx < n; idx++) {
+        present[idx] = false;
+        rc[idx] = 0;
+
+        entry = pm_sysfs_port(ports[idx]);
+        if (NULL == entry || 0 != pm_sysfs_open(&entry->a0)) {
+            continue;
+        }
+
+        ios[count].fd = entry->a0.fd;
+        ios[count].buf = &bytes[count];
+        ios[count].len = 1;
+        ios[count].pos = 0;
+        ios[count].write = false;
+        port_of[count++] = idx;
+    }
+
+    pm_io_submit(ios, count);
+
+    for (idx = 0; idx < count; idx++) {
+        present[port_of[idx]] = (1 == ios[idx].res);
+    }
+
+    free(port_of);
+    free(bytes);
+    free(ios);
+}
+
+static int
+pm_sysfs_presence(pm_port_t *port, bool *present)
+{
+    int rc;
+
+    pm_sysfs_presence_batch(&port, 1, present, &rc);
+
+    return rc;
+}
+
+static void
+pm_sysfs_sweep_end(void)
+{
+    pm_backend_i2c.sweep_end();
+}
+
+static int
+pm_sysfs_reset(pm_port_t *port, bool asserted)
+{
+    return pm_backend_i2c.reset(port, asserted);
+}
+
+static int
+pm_sysfs_tx_disable(pm_port_t *port, uint8_t mask)
+{
+    // QSFP lanes are disabled through the eeprom
+    if (0 != strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
+        return pm_sysfs_write(port, PM_EEPROM_A0, 0, QSFP_DISABLE_OFFSET,
+                              sizeof(mask), &mask);
+    }
+
+    return pm_backend_i2c.tx_disable(port, mask);
+}
+
+//
+// pm_sysfs_paged: optoe files hold the upper pages by page number; at24
+//                 files are a single eeprom space
+//
+static bool
+pm_sysfs_paged(const pm_port_t *port)
+{
+    struct pm_sysfs_port *entry = port->backend_data;
+
+    if (NULL == entry) {
+        entry = shash_find_data(&pm_sysfs_ports, port->instance);
+    }
+
+    return NULL != entry && 0 == pm_sysfs_open(&entry->a0) &&
+           entry->a0.size > PM_EEPROM_SPACE_SIZE;
+}
+
+const struct pm_backend_class pm_backend_sysfs = {
+    .name = "sysfs",
+    .arg_usage = "file mapping each interface to its eeprom file(s)",
+    .init = pm_sysfs_init,
+    .port_destroy = NULL,
+    .presence = pm_sysfs_presence,
+    .read = pm_sysfs_read,
+    .write = pm_sysfs_write,
+    .reset = pm_sysfs_reset,
+    .tx_disable = pm_sysfs_tx_disable,
+    .presence_batch = pm_sysfs_presence_batch,
+    .read_batch = pm_sysfs_read_batch,
+    .sweep_end = pm_sysfs_sweep_end,
+    .paged = pm_sysfs_paged,
+};
@@ -0,0 +1,781 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for pluggable module I2C bus accounting.
+ *
+ * Every transaction pmd issues is charged to the bus it runs on. At the
+ * end of each sweep the totals are pushed into a per-bus time series, so
+ * the dump shows how evenly the load is spread over time.
+ *
+ * Devices behind I2C muxes carry the mux selects as pre operations. The
+ * selects of a device are its mux path; a transaction on a different path
+ * than the previous one on the same bus counts as a mux switch.
+ *
+ * Operations fall in priority classes. A sweep does presence checks and
+ * identification before telemetry, and control operations (tx disable,
+ * reset) are issued between sweeps, so they only ever wait for the sweep
+ * in progress. To keep that wait short, identification and telemetry get
+ * --bus-budget percent of each bus's time through a token bucket; what
+ * does not fit is deferred to a later sweep.
+ *
+ * Other platform daemons reach the same buses and muxes through
+ * config-yaml. Sequences of transactions that must not be interleaved
+ * with theirs, such as a mux select, the transfer behind it and the
+ * deselect, are done under an advisory lock: flock() on
+ * <bus lock dir>/i2c-<bus>.lock, by default in the OVS run directory. Any
+ * daemon taking the same lock around its own sequences is serialized with
+ * pmd. pmd holds the lock only for one mux leg at a time and gives up
+ * after PM_BUS_LOCK_TIMEOUT msecs, failing the access rather than
+ * colliding; waits and hold times are shown in the bus dump.
+ *
+ * A module holding SDA low makes every transaction on its bus time out,
+ * one after the other. EEPROM operations therefore have a deadline
+ * (--op-deadline); the batched file I/O cancels operations that overrun
+ * it, and any operation completing past it counts as late. Backends that
+ * take the bus lock report the time of their transfers once the lock is
+ * held, so waiting for another process is not counted, and an operation
+ * that could not get the lock is not late at all. After
+ * PM_BUS_HUNG_THRESHOLD late operations in a row the bus is hung: it is
+ * quarantined, so its operations fail at once while other buses carry on,
+ * and the module of the last late operation is reset at the end of the
+ * sweep. When the quarantine is over the bus is probed; one more late
+ * operation quarantines it again, for twice as long.
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#include <dirs.h>
+#include <shash.h>
+#include <timeval.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "pm_bus.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_bus);
+
+static struct shash pm_buses = SHASH_INITIALIZER(&pm_buses);
+
+// mux switches per sweep expected in hash table order and in sweep order,
+// as last planned
+static unsigned int pm_bus_plan_unordered;
+static unsigned int pm_bus_plan_ordered;
+
+unsigned int pm_bus_budget = PM_BUS_BUDGET_DEFAULT;
+
+// deadline of an EEPROM operation in msecs; 0 disables hung bus detection
+unsigned int pm_bus_deadline = PM_BUS_DEADLINE_DEFAULT;
+
+// directory of the bus lock files; NULL for the OVS run directory, ""
+// to disable locking
+char *pm_bus_lock_dir = NULL;
+
+// class of the operations being charged
+static enum pm_op_class pm_bus_class = PM_OP_CONTROL;
+
+static const char *const pm_bus_class_names[] = {
+    [PM_OP_CONTROL] = "control",
+    [PM_OP_PRESENCE] = "presence",
+    [PM_OP_IDENTIFY] = "identify",
+    [PM_OP_TELEMETRY] = "telemetry",
+};
+
+//
+// pm_bus_get: find a bus by name, creating it on first use
+//
+// input: bus name
+//
+// output: bus structure
+//
+pm_bus_t *
+pm_bus_get(const char *name)
+{
+    pm_bus_t *bus;
+
+    bus = shash_find_data(&pm_buses, name);
+    if (NULL == bus) {
+        bus = xzalloc(sizeof(pm_bus_t));
+        bus->name = xstrdup(name);
+        bus->lock_fd = -1;
+        bus->op_usec = -1;
+        bus->quarantine_msec = PM_BUS_QUARANTINE_MIN;
+        shash_add(&pm_buses, bus->name, bus);
+        VLOG_DBG("tracking bus %s", bus->name);
+    }
+
+    return bus;
+}
+
+//
+// pm_bus_usec: monotonic time in microseconds, for timing transactions
+//
+long long int
+pm_bus_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long int)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+//
+// pm_bus_account: charge one transaction to a bus
+//
+// input: bus (may be NULL), bytes transferred, pm_bus_usec() value taken
+//        when the transaction started
+//
+// output: none
+//
+void
+pm_bus_account(pm_bus_t *bus, size_t bytes, long long int start_usec)
+{
+    pm_bus_charge(bus, bytes, pm_bus_usec() - start_usec);
+}
+
+//
+// pm_bus_charge: charge one transaction of known duration to a bus, e.g.
+//                a share of a batch whose transactions overlapped
+//
+// input: bus (may be NULL), bytes transferred, usecs
+//
+// output: none
+//
+void
+pm_bus_charge(pm_bus_t *bus, size_t bytes, long long int usec)
+{
+    if (NULL == bus) {
+        return;
+    }
+
+    bus->current.busy_usec += usec;
+    bus->current.class_usec[pm_bus_class] += usec;
+    bus->current.bytes += bytes;
+    bus->current.transactions++;
+
+    if (pm_bus_class >= PM_OP_IDENTIFY) {
+        bus->tokens -= usec;
+    }
+}
+
+//
+// pm_bus_lock_open: open the lock file of a bus on first use
+//
+static void
+pm_bus_lock_open(pm_bus_t *bus)
+{
+    const char  *dir = pm_bus_lock_dir ? pm_bus_lock_dir : ovs_rundir();
+    char        *path;
+    char        *p;
+
+    bus->lock_tried = true;
+
+    if ('\0' == dir[0]) {
+        return;
+    }
+
+    path = xasprintf("%s/i2c-%s.lock", dir, bus->name);
+    // bus names may contain slashes, e.g. /dev/i2c-1
+    for (p = path + strlen(dir) + 1; '\0' != *p; p++) {
+        if ('/' == *p) {
+            *p = '_';
+        }
+    }
+
+    bus->lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (bus->lock_fd < 0) {
+        VLOG_WARN("unable to open bus lock %s (%s), bus %s is not "
+                  "arbitrated", path, ovs_strerror(errno), bus->name);
+    }
+
+    free(path);
+}
+
+//
+// pm_bus_lock: take the cross-process lock of a bus. Nested calls only
+//              count; the lock is taken by the outermost one.
+//
+// input: bus (may be NULL)
+//
+// output: 0 on success (or if the bus is not arbitrated), -1 if another
+//         process kept the bus for PM_BUS_LOCK_TIMEOUT msecs
+//
+int
+pm_bus_lock(pm_bus_t *bus)
+{
+    long long int start;
+    long long int wait;
+
+    if (NULL == bus) {
+        return 0;
+    }
+    if (!bus->lock_tried) {
+        pm_bus_lock_open(bus);
+    }
+    if (bus->lock_fd < 0 || bus->lock_depth++ > 0) {
+        return 0;
+    }
+
+    start = pm_bus_usec();
+    if (0 != flock(bus->lock_fd, LOCK_EX | LOCK_NB)) {
+        bus->lock_contended++;
+        for (;;) {
+            // poll rather than block, so a stuck holder cannot hang pmd
+            xnanosleep(100 * 1000);
+            if (0 == flock(bus->lock_fd, LOCK_EX | LOCK_NB)) {
+                break;
+            }
+            if (pm_bus_usec() - start >= PM_BUS_LOCK_TIMEOUT * 1000LL) {
+                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+                VLOG_WARN_RL(&rl, "bus %s has been locked by another "
+                             "process for %dms", bus->name,
+                             PM_BUS_LOCK_TIMEOUT);
+                bus->lock_timeouts++;
+                bus->lock_depth--;
+                bus->op_lock_failed = true;
+                return -1;
+            }
+        }
+    }
+
+    bus->lock_since = pm_bus_usec();
+    wait = bus->lock_since - start;
+    bus->lock_acquires++;
+    bus->lock_wait_max = MAX(bus->lock_wait_max, wait);
+    bus->current.lock_wait_usec += wait;
+
+    return 0;
+}
+
+void
+pm_bus_unlock(pm_bus_t *bus)
+{
+    long long int hold;
+
+    if (NULL == bus || bus->lock_fd < 0 || 0 == bus->lock_depth ||
+        --bus->lock_depth > 0) {
+        return;
+    }
+
+    flock(bus->lock_fd, LOCK_UN);
+
+    hold = pm_bus_usec() - bus->lock_since;
+    bus->lock_hold_max = MAX(bus->lock_hold_max, hold);
+    bus->current.lock_hold_usec += hold;
+}
+
+//
+// pm_bus_quarantined: tell whether a bus is out of service, without
+//                     counting anything
+//
+// input: bus (may be NULL)
+//
+// output: true if operations on the bus are refused
+//
+bool
+pm_bus_quarantined(const pm_bus_t *bus)
+{
+    return NULL != bus && 0 != bus->quarantine_until &&
+           (bus->hung || time_msec() < bus->quarantine_until);
+}
+
+//
+// pm_bus_usable: admit an EEPROM operation on a bus, putting the bus on
+//                probation once its quarantine is over
+//
+// input: bus (may be NULL)
+//
+// output: true if the operation may run
+//
+bool
+pm_bus_usable(pm_bus_t *bus)
+{
+    if (NULL == bus || 0 == bus->quarantine_until) {
+        return true;
+    }
+
+    if (pm_bus_quarantined(bus)) {
+        bus->skipped++;
+        return false;
+    }
+
+    // a single late operation is enough to send it back
+    VLOG_INFO("bus %s: quarantine over, probing", bus->name);
+    bus->quarantine_until = 0;
+    bus->probing = true;
+    bus->late = PM_BUS_HUNG_THRESHOLD - 1;
+
+    return true;
+}
+
+//
+// pm_bus_op_begin: start an EEPROM operation on a bus, before the backend
+//                  runs it
+//
+// input: bus (may be NULL)
+//
+// output: none
+//
+void
+pm_bus_op_begin(pm_bus_t *bus)
+{
+    if (NULL != bus) {
+        bus->op_usec = -1;
+        bus->op_lock_failed = false;
+    }
+}
+
+//
+// pm_bus_transferred: report the bus time of a transfer of the operation
+//                     in progress, from when the bus lock was held
+//
+// input: bus (may be NULL), pm_bus_usec() when the transfer started
+//
+// output: none
+//
+void
+pm_bus_transferred(pm_bus_t *bus, long long int start_usec)
+{
+    if (NULL != bus) {
+        bus->op_usec = MAX(bus->op_usec, 0) + pm_bus_usec() - start_usec;
+    }
+}
+
+//
+// pm_bus_op_usec: duration of the operation in progress to check against
+//                 the deadline: the transfer time the backend reported,
+//                 or else the time since it started
+//
+// input: bus (may be NULL), pm_bus_usec() when the operation started
+//
+// output: usecs
+//
+long long int
+pm_bus_op_usec(const pm_bus_t *bus, long long int start_usec)
+{
+    if (NULL != bus && bus->op_usec >= 0) {
+        return bus->op_usec;
+    }
+    return pm_bus_usec() - start_usec;
+}
+
+//
+// pm_bus_complete: check an EEPROM operation against the deadline and
+//                  quarantine the bus once too many in a row are late
+//
+// input: bus (may be NULL), port the operation was for, its duration in
+//        usecs, its result
+//
+// output: none
+//
+void
+pm_bus_complete(pm_bus_t *bus, const char *instance, long long int usec,
+                int rc)
+{
+    if (NULL == bus || 0 == pm_bus_deadline) {
+        return;
+    }
+
+    // another process kept the bus: nothing is known about the bus itself
+    if (bus->op_lock_failed) {
+        return;
+    }
+
+    if (usec < pm_bus_deadline * 1000LL) {
+        if (0 == rc) {
+            bus->late = 0;
+            if (bus->probing) {
+                VLOG_INFO("bus %s: back in service", bus->name);
+                bus->probing = false;
+                bus->quarantine_msec = PM_BUS_QUARANTINE_MIN;
+            }
+        }
+        return;
+    }
+
+    bus->current.late++;
+    free(bus->offender);
+    bus->offender = xstrdup(instance);
+
+    if (++bus->late < PM_BUS_HUNG_THRESHOLD || bus->hung) {
+        return;
+    }
+
+    VLOG_ERR("bus %s: hung after %u operations over %ums, last on %s; "
+             "quarantined for %lldms", bus->name, bus->late,
+             pm_bus_deadline, instance, bus->quarantine_msec);
+
+    bus->hung = true;
+    bus->probing = false;
+    bus->hangs++;
+    bus->quarantine_until = time_msec() + bus->quarantine_msec;
+    bus->quarantine_msec = MIN(2 * bus->quarantine_msec,
+                               PM_BUS_QUARANTINE_MAX);
+}
+
+//
+// pm_bus_recovered: note that recovery of a hung bus was attempted; it
+//                   stays quarantined until its time is up
+//
+// input: bus
+//
+// output: none
+//
+void
+pm_bus_recovered(pm_bus_t *bus)
+{
+    bus->hung = false;
+    bus->late = 0;
+    bus->recoveries++;
+
+    // the muxes may have been reset along with the bus
+    pm_bus_invalidate(bus);
+    free(bus->mux_path);
+    bus->mux_path = NULL;
+}
+
+//
+// pm_bus_set_class: set the class that following transactions belong to
+//
+void
+pm_bus_set_class(enum pm_op_class cls)
+{
+    pm_bus_class = cls;
+}
+
+//
+// pm_bus_has_budget: tell whether an operation of a class may run on a
+//                    bus now. Only identification and telemetry are
+//                    budgeted.
+//
+// input: bus (may be NULL), class
+//
+// output: true if the operation may run
+//
+bool
+pm_bus_has_budget(pm_bus_t *bus, enum pm_op_class cls)
+{
+    long long int capacity;
+    long long int now;
+
+    if (cls < PM_OP_IDENTIFY || pm_bus_budget >= 100 || NULL == bus) {
+        return true;
+    }
+
+    capacity = (long long int)PM_BUS_BUCKET_USEC * pm_bus_budget / 100;
+    now = pm_bus_usec();
+
+    if (0 == bus->refill_time) {
+        bus->tokens = capacity;
+    } else {
+        bus->tokens += (now - bus->refill_time) * pm_bus_budget / 100;
+        bus->tokens = MIN(bus->tokens, capacity);
+    }
+    bus->refill_time = now;
+
+    return bus->tokens > 0;
+}
+
+//
+// pm_bus_admit: like pm_bus_has_budget, but also counts a refused
+//               operation as deferred and makes an admitted one's class
+//               the current class
+//
+bool
+pm_bus_admit(pm_bus_t *bus, enum pm_op_class cls)
+{
+    if (!pm_bus_has_budget(bus, cls)) {
+        if (NULL != bus) {
+            bus->current.deferred++;
+        }
+        return false;
+    }
+
+    pm_bus_class = cls;
+
+    return true;
+}
+
+//
+// pm_bus_mux_path: describe the mux selects in front of a device as a
+//                  string that sorts by mux and then channel, e.g.
+//                  "i2c_mux_1@0x0=04/i2c_mux_4@0x0=01"
+//
+// input: device (may be NULL)
+//
+// output: allocated string, empty if the device is not behind a mux
+//
+char *
+pm_bus_mux_path(const YamlDevice *device)
+{
+    struct ds   path = DS_EMPTY_INITIALIZER;
+    i2c_op      **ops;
+    uint32_t    idx;
+
+    if (NULL != device && NULL != device->pre) {
+        for (ops = device->pre; NULL != *ops; ops++) {
+            if (WRITE != (*ops)->direction) {
+                continue;
+            }
+            if (path.length != 0) {
+                ds_put_char(&path, '/');
+            }
+            ds_put_format(&path, "%s@%#"PRIx32"=", (*ops)->device,
+                          (*ops)->register_address);
+            for (idx = 0; idx < (*ops)->byte_count; idx++) {
+                ds_put_format(&path, "%02x", (*ops)->data[idx]);
+            }
+        }
+    }
+
+    return ds_steal_cstr(&path);
+}
+
+//
+// pm_bus_select: note the mux path of a transaction about to run on a bus
+//
+// input: bus (may be NULL), mux path (NULL or empty if none)
+//
+// output: none
+//
+void
+pm_bus_select(pm_bus_t *bus, const char *mux_path)
+{
+    if (NULL == bus || NULL == mux_path || '\0' == mux_path[0]) {
+        return;
+    }
+
+    if (NULL == bus->mux_path || 0 != strcmp(bus->mux_path, mux_path)) {
+        free(bus->mux_path);
+        bus->mux_path = xstrdup(mux_path);
+        bus->current.mux_switches++;
+    }
+}
+
+//
+// pm_bus_set_mux_owner: record which device's mux selects are in effect
+//
+// input: bus, device (NULL once deselected), its subsystem
+//
+// output: none
+//
+void
+pm_bus_set_mux_owner(pm_bus_t *bus, const YamlDevice *device,
+                     const char *subsystem)
+{
+    bus->mux_owner = device;
+    if (NULL == device) {
+        free(bus->mux_subsystem);
+        bus->mux_subsystem = NULL;
+    } else if (NULL == bus->mux_subsystem ||
+               0 != strcmp(bus->mux_subsystem, subsystem)) {
+        free(bus->mux_subsystem);
+        bus->mux_subsystem = xstrdup(subsystem);
+    }
+}
+
+//
+// pm_bus_invalidate: forget the mux shadow of a bus whose muxes may have
+//                    changed behind pmd's back, e.g. after a bus reset, so
+//                    the next access selects from scratch
+//
+// input: bus (may be NULL)
+//
+// output: none
+//
+void
+pm_bus_invalidate(pm_bus_t *bus)
+{
+    if (NULL != bus) {
+        pm_bus_set_mux_owner(bus, NULL, NULL);
+    }
+}
+
+void
+pm_bus_for_each(void (*cb)(pm_bus_t *bus))
+{
+    struct shash_node *node;
+
+    SHASH_FOR_EACH(node, &pm_buses) {
+        cb(node->data);
+    }
+}
+
+//
+// pm_bus_plan: record the mux switches a sweep would need in hash table
+//              order and in the order the sweep actually takes
+//
+void
+pm_bus_plan(unsigned int unordered, unsigned int ordered)
+{
+    if (unordered != pm_bus_plan_unordered ||
+        ordered != pm_bus_plan_ordered) {
+        VLOG_INFO("sweep order needs %u mux switches, %u in hash order",
+                  ordered, unordered);
+    }
+
+    pm_bus_plan_unordered = unordered;
+    pm_bus_plan_ordered = ordered;
+}
+
+//
+// pm_bus_sweep_end: close the current sweep on every bus and append its
+//                   usage to the bus's time series
+//
+void
+pm_bus_sweep_end(void)
+{
+    struct shash_node *node;
+    long long int now = time_wall_msec();
+
+    SHASH_FOR_EACH(node, &pm_buses) {
+        pm_bus_t *bus = node->data;
+
+        bus->current.time = now;
+        bus->history[bus->head] = bus->current;
+        bus->head = (bus->head + 1) % PM_BUS_HISTORY_SIZE;
+        if (bus->count < PM_BUS_HISTORY_SIZE) {
+            bus->count++;
+        }
+
+        memset(&bus->current, 0, sizeof(bus->current));
+    }
+}
+
+static void
+pm_bus_history_dump(struct ds *ds, const pm_bus_t *bus)
+{
+    const pm_bus_sample_t *sample;
+    const pm_bus_sample_t *prev = NULL;
+    double      occupancy;
+    double      peak = 0;
+    double      total = 0;
+    size_t      start;
+    size_t      idx;
+    long long int period;
+    unsigned long long class_usec[PM_OP_N_CLASSES] = { 0 };
+    int         cls;
+
+    start = (bus->head + PM_BUS_HISTORY_SIZE - bus->count) % PM_BUS_HISTORY_SIZE;
+
+    ds_put_format(ds, "Bus %s:\n", bus->name);
+    ds_put_cstr(ds, "    time(ms)       busy(us)  bytes  xfers  muxsw  muxop  saved"
+                "  defer  wait(us)  hold(us)   late  busy%\n");
+
+    for (idx = 0; idx < bus->count; idx++) {
+        sample = &bus->history[(start + idx) % PM_BUS_HISTORY_SIZE];
+
+        // occupancy is busy time over the time since the previous sweep
+        period = prev ? sample->time - prev->time : PM_INTERVAL;
+        if (period <= 0) {
+            period = PM_INTERVAL;
+        }
+        occupancy = (100.0 * sample->busy_usec) / (period * 1000.0);
+
+        if (occupancy > peak) {
+            peak = occupancy;
+        }
+        total += occupancy;
+
+        ds_put_format(ds, "    %-14lld %8"PRIu32" %6"PRIu32" %6"PRIu32
+                      " %6"PRIu32" %6"PRIu32" %6"PRIu32" %6"PRIu32
+                      " %9"PRIu32" %9"PRIu32" %6"PRIu32" %6.2f\n",
+                      sample->time, sample->busy_usec, sample->bytes,
+                      sample->transactions, sample->mux_switches,
+                      sample->mux_ops, sample->mux_ops_saved,
+                      sample->deferred, sample->lock_wait_usec,
+                      sample->lock_hold_usec, sample->late, occupancy);
+        for (cls = 0; cls < PM_OP_N_CLASSES; cls++) {
+            class_usec[cls] += sample->class_usec[cls];
+        }
+        prev = sample;
+    }
+
+    if (bus->count != 0 && total > 0) {
+        double average = total / bus->count;
+
+        ds_put_format(ds, "    peak %.2f%%, average %.2f%%, "
+                      "peak-to-average %.2f\n", peak, average, peak / average);
+    }
+
+    ds_put_cstr(ds, "    busy time by class:");
+    for (cls = 0; cls < PM_OP_N_CLASSES; cls++) {
+        ds_put_format(ds, " %s %lluus", pm_bus_class_names[cls],
+                      class_usec[cls]);
+    }
+    ds_put_format(ds, "\n    budget tokens %lldus\n", bus->tokens);
+
+    if (bus->lock_fd >= 0) {
+        ds_put_format(ds, "    lock: acquired %llu, contended %llu, "
+                      "timed out %llu, max wait %lldus, max hold %lldus\n",
+                      bus->lock_acquires, bus->lock_contended,
+                      bus->lock_timeouts, bus->lock_wait_max,
+                      bus->lock_hold_max);
+    } else if (bus->lock_tried) {
+        ds_put_cstr(ds, "    lock: not arbitrated\n");
+    }
+
+    if (pm_bus_quarantined(bus)) {
+        ds_put_format(ds, "    health: quarantined%s for %lldms more",
+                      bus->hung ? " (recovery pending)" : "",
+                      MAX(bus->quarantine_until - time_msec(), 0));
+    } else {
+        ds_put_format(ds, "    health: %s, %u late in a row",
+                      bus->probing ? "probing" : "ok", bus->late);
+    }
+    ds_put_format(ds, ", hangs %llu, recoveries %llu, skipped %llu",
+                  bus->hangs, bus->recoveries, bus->skipped);
+    if (NULL != bus->offender) {
+        ds_put_format(ds, ", last late on %s", bus->offender);
+    }
+    ds_put_char(ds, '\n');
+}
+
+//
+// pm_bus_dump: dump the occupancy time series of all buses
+//
+void
+pm_bus_dump(struct ds *ds)
+{
+    const struct shash_node **nodes;
+    size_t idx;
+
+    ds_put_cstr(ds, "================ Buses ================\n");
+    ds_put_format(ds, "mux switches per sweep: %u in hash order, "
+                  "%u in sweep order\n", pm_bus_plan_unordered,
+                  pm_bus_plan_ordered);
+    ds_put_format(ds, "identify/telemetry budget: %u%% of bus time\n",
+                  pm_bus_budget);
+
+    nodes = shash_sort(&pm_buses);
+    for (idx = 0; idx < shash_count(&pm_buses); idx++) {
+        pm_bus_history_dump(ds, nodes[idx]->data);
+    }
+    free(nodes);
+}
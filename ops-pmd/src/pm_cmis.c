@@ -0,0 +1,534 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for modules with a CMIS memory map (QSFP-DD, OSFP).
+ *
+ * Identification reads upper page 00h, like the serial ID of a QSFP. DOM
+ * polling reads the lower page and the upper pages in pm_cmis_pages: the
+ * advertising and threshold pages once after insertion, retried with a
+ * growing interval while they fail, and the lane status page, if the
+ * module advertises lane monitors, on the schedule of pm_dom_plan(),
+ * which orders the reads of a poll by page so each page is selected at
+ * most once. A page select is only written when it changes, so a port
+ * polled for lane status alone keeps that page selected and costs no
+ * writes at all.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vswitch-idl.h>
+#include <openswitch-idl.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "pm_backend.h"
+#include "pm_cmis.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_cmis);
+
+BUILD_ASSERT_DECL(sizeof(pm_cmis_serial_id_t) == PM_CMIS_PAGE_SIZE);
+
+static const pm_dom_flag_t pm_cmis_dom_flags[] = {
+    PM_CMIS_DOM_FLAGS(PM_DOM_FLAG)
+};
+
+#define PM_CMIS_DOM_FLAG_IN_PAGE(column, offset, bit) \
+    BUILD_ASSERT_DECL((offset) == PM_CMIS_MODULE_FLAGS && (bit) < 8);
+
+PM_CMIS_DOM_FLAGS(PM_CMIS_DOM_FLAG_IN_PAGE)
+
+static const struct {
+    const char  *name;
+    uint8_t     bank;
+    uint8_t     page;
+} pm_cmis_pages[PM_CMIS_N_PAGES] = {
+    [PM_CMIS_PAGE_ADVERTISING] = { "01h", 0, PM_CMIS_ADVERTISING },
+    [PM_CMIS_PAGE_THRESHOLDS] = { "02h", 0, PM_CMIS_THRESHOLDS },
+    [PM_CMIS_PAGE_LANES] = { "11h", 0, PM_CMIS_LANE_STATUS },
+};
+
+//
+// pm_cmis_port: whether a port is a CMIS cage
+//
+bool
+pm_cmis_port(const pm_port_t *port)
+{
+    const char *connector = port->module_device->connector;
+
+    return NULL != connector &&
+           (0 == strcmp(connector, CONNECTOR_QSFP_DD) ||
+            0 == strcmp(connector, CONNECTOR_OSFP));
+}
+
+void
+pm_cmis_init(pm_port_t *port)
+{
+    if (pm_cmis_port(port)) {
+        port->cmis = xzalloc(sizeof(*port->cmis));
+        port->cmis->retry_interval = PM_CMIS_RETRY_MIN;
+    }
+}
+
+void
+pm_cmis_destroy(pm_port_t *port)
+{
+    free(port->cmis);
+    port->cmis = NULL;
+}
+
+//
+// pm_cmis_forget: forget the page select of a module that was replaced
+//                 or reset, which starts over on page 00h
+//
+void
+pm_cmis_forget(pm_port_t *port)
+{
+    if (NULL != port->cmis) {
+        port->cmis->selected = false;
+    }
+}
+
+//
+// pm_cmis_reset: forget the upper pages read from a module, so they are
+//                read again for the next one
+//
+void
+pm_cmis_reset(pm_port_t *port)
+{
+    if (NULL != port->cmis) {
+        port->cmis->flat = false;
+        port->cmis->loaded = 0;
+        port->cmis->retry_due = 0;
+        port->cmis->retry_interval = PM_CMIS_RETRY_MIN;
+        memset(port->cmis->pages, 0, sizeof(port->cmis->pages));
+    }
+}
+
+bool
+pm_cmis_selected(const pm_port_t *port, uint8_t bank, uint8_t page)
+{
+    const pm_cmis_t *cmis = port->cmis;
+
+    // paged backends (optoe) reach the pages of bank 0 by number
+    if (pm_backend_paged(port)) {
+        return 0 == bank;
+    }
+
+    return cmis->selected && cmis->bank == bank && cmis->page == page;
+}
+
+//
+// pm_cmis_select: make an upper page accessible, unless it already is
+//
+// input: port structure, bank and page
+//
+// output: 0 on success, non-zero on failure
+//
+static int
+pm_cmis_select(pm_port_t *port, uint8_t bank, uint8_t page)
+{
+    pm_cmis_t       *cmis = port->cmis;
+    unsigned char   select[2] = { bank, page };
+    int             rc;
+
+    // flat modules only have page 00h, and ignore the select
+    if (cmis->flat) {
+        return (0 == bank && 0 == page) ? 0 : -1;
+    }
+
+    if (pm_cmis_selected(port, bank, page)) {
+        cmis->n_skipped++;
+        return 0;
+    }
+
+    // and have no other banks; selects would work against their paging
+    if (pm_backend_paged(port)) {
+        return -1;
+    }
+
+    // writing the page select byte commits the selection, so the bank
+    // only has to be written along with it when it changes
+    if (cmis->selected && cmis->bank == bank) {
+        rc = pm_backend_write(port, PM_EEPROM_A0, 0, PM_CMIS_PAGE_SELECT,
+                              sizeof(select[1]), &select[1]);
+    } else {
+        rc = pm_backend_write(port, PM_EEPROM_A0, 0, PM_CMIS_BANK_SELECT,
+                              sizeof(select), select);
+    }
+    cmis->n_selects++;
+
+    cmis->selected = (0 == rc);
+    cmis->bank = bank;
+    cmis->page = page;
+
+    return rc;
+}
+
+//
+// pm_cmis_read: read a byte range of a module, selecting the upper page
+//               first if the range is in one
+//
+// input: port structure, bank and page, offset, length, buffer
+//
+// output: 0 on success, non-zero on failure
+//
+int
+pm_cmis_read(pm_port_t *port, uint8_t bank, uint8_t page, size_t offset,
+             size_t len, unsigned char *data)
+{
+    int rc = 0;
+
+    if (offset + len > PM_CMIS_UPPER_OFFSET) {
+        rc = pm_cmis_select(port, bank, page);
+    }
+    if (0 == rc) {
+        rc = pm_backend_read(port, PM_EEPROM_A0, page, offset, len, data);
+    }
+
+    // the module may have been reset under us
+    if (0 != rc) {
+        pm_cmis_forget(port);
+    }
+
+    return rc;
+}
+
+int
+pm_cmis_write(pm_port_t *port, uint8_t bank, uint8_t page, size_t offset,
+              size_t len, const unsigned char *data)
+{
+    int rc = 0;
+
+    if (offset + len > PM_CMIS_UPPER_OFFSET) {
+        rc = pm_cmis_select(port, bank, page);
+    }
+    if (0 == rc) {
+        rc = pm_backend_write(port, PM_EEPROM_A0, page, offset, len, data);
+    }
+
+    if (0 != rc) {
+        pm_cmis_forget(port);
+    }
+
+    return rc;
+}
+
+//
+// pm_cmis_tx_disable: set the transmitter disable mask, bit per lane
+//
+// input: port structure, mask
+//
+// output: 0 on success, non-zero on failure
+//
+int
+pm_cmis_tx_disable(pm_port_t *port, uint8_t mask)
+{
+    // flat modules have no lane controls
+    if (port->cmis->flat) {
+        return 0;
+    }
+
+    return pm_cmis_write(port, 0, PM_CMIS_LANE_CONTROL, PM_CMIS_TX_DISABLE,
+                         sizeof(mask), &mask);
+}
+
+static bool
+pm_cmis_page_loaded(const pm_cmis_t *cmis, enum pm_cmis_page idx)
+{
+    return !cmis->flat && 0 != (cmis->loaded & (1u << idx));
+}
+
+//
+// pm_cmis_lanes_monitored: whether the module advertises lane monitors,
+//                          which are read from the lane status page
+//
+bool
+pm_cmis_lanes_monitored(const pm_port_t *port)
+{
+    const pm_cmis_t *cmis = port->cmis;
+
+    return pm_cmis_page_loaded(cmis, PM_CMIS_PAGE_ADVERTISING) &&
+           0 != (PM_CMIS_UPPER(cmis->pages[PM_CMIS_PAGE_ADVERTISING],
+                               PM_CMIS_LANE_MONITORS) &
+                 PM_CMIS_LANE_MONITORS_MASK);
+}
+
+//
+// pm_cmis_plan_pages: plan a full read of each upper page the module
+//                     provides and that has not been read since it was
+//                     inserted. Pages that keep failing are tried again
+//                     after a doubling interval, up to PM_CMIS_RETRY_MAX.
+//
+// input: port structure, current monotonic time in msecs, output array
+//        with room for PM_CMIS_N_PAGES reads
+//
+// output: number of reads
+//
+size_t
+pm_cmis_plan_pages(pm_port_t *port, long long int now, pm_dom_read_t reads[])
+{
+    pm_cmis_t   *cmis = port->cmis;
+    size_t      count = 0;
+    size_t      idx;
+
+    if (cmis->flat || cmis->retry_due > now) {
+        return 0;
+    }
+
+    for (idx = 0; idx < PM_CMIS_N_PAGES; idx++) {
+        if (cmis->loaded & (1u << idx)) {
+            continue;
+        }
+        // lane status is only read for the lane monitors
+        if (PM_CMIS_PAGE_LANES == idx && !pm_cmis_lanes_monitored(port)) {
+            continue;
+        }
+        reads[count++] = (pm_dom_read_t) {
+            .offset = PM_CMIS_UPPER_OFFSET,
+            .len = PM_CMIS_PAGE_SIZE,
+            .bank = pm_cmis_pages[idx].bank,
+            .page = pm_cmis_pages[idx].page,
+        };
+    }
+
+    if (0 != count) {
+        cmis->retry_due = now + cmis->retry_interval;
+        cmis->retry_interval = MIN(2 * cmis->retry_interval,
+                                   PM_CMIS_RETRY_MAX);
+    }
+
+    return count;
+}
+
+static int
+pm_cmis_page_index(uint8_t bank, uint8_t page)
+{
+    int idx;
+
+    for (idx = 0; idx < PM_CMIS_N_PAGES; idx++) {
+        if (pm_cmis_pages[idx].bank == bank &&
+            pm_cmis_pages[idx].page == page) {
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+//
+// pm_cmis_buffer: where a DOM read lands. The lower page is kept in the
+//                 port's DOM page, the upper pages in the CMIS state.
+//
+// input: port structure, read
+//
+// output: buffer, NULL for a page that is not kept
+//
+unsigned char *
+pm_cmis_buffer(pm_port_t *port, const pm_dom_read_t *read)
+{
+    int idx;
+
+    if (read->offset < PM_CMIS_UPPER_OFFSET) {
+        return port->dom.page + read->offset;
+    }
+
+    idx = pm_cmis_page_index(read->bank, read->page);
+    if (idx < 0) {
+        return NULL;
+    }
+
+    return port->cmis->pages[idx] + (read->offset - PM_CMIS_UPPER_OFFSET);
+}
+
+//
+// pm_cmis_read_dom: carry out a read planned by pm_dom_plan()
+//
+// input: port structure, read
+//
+// output: 0 on success, non-zero on failure
+//
+int
+pm_cmis_read_dom(pm_port_t *port, const pm_dom_read_t *read)
+{
+    unsigned char *data = pm_cmis_buffer(port, read);
+
+    if (NULL == data) {
+        return -1;
+    }
+
+    // the upper pages of a flat module stay empty
+    if (port->cmis->flat && read->offset >= PM_CMIS_UPPER_OFFSET) {
+        return 0;
+    }
+
+    return pm_cmis_read(port, read->bank, read->page, read->offset,
+                        read->len, data);
+}
+
+//
+// pm_cmis_loaded: note a DOM read that succeeded. A full read of the
+//                 lower page tells whether the module is flat; a full
+//                 read of an upper page does not have to be planned again.
+//
+// input: port structure, read
+//
+// output: none
+//
+void
+pm_cmis_loaded(pm_port_t *port, const pm_dom_read_t *read)
+{
+    pm_cmis_t   *cmis = port->cmis;
+    int         idx;
+
+    if (read->offset <= PM_CMIS_STATUS &&
+        read->offset + read->len > PM_CMIS_STATUS) {
+        cmis->flat = (0 != (port->dom.page[PM_CMIS_STATUS] &
+                            PM_CMIS_FLAT_MEMORY));
+    }
+
+    if (PM_CMIS_UPPER_OFFSET != read->offset ||
+        PM_CMIS_PAGE_SIZE != read->len) {
+        return;
+    }
+
+    idx = pm_cmis_page_index(read->bank, read->page);
+    if (idx >= 0) {
+        cmis->loaded |= 1u << idx;
+    }
+}
+
+// raw 16-bit value at a module address of an upper page image
+static uint16_t
+pm_cmis_word(const unsigned char *image, size_t offset)
+{
+    return PM_DOM_RAW16(PM_CMIS_UPPER(image, offset),
+                        PM_CMIS_UPPER(image, offset + 1));
+}
+
+//
+// pm_cmis_set_dom: set the DOM columns of a CMIS module and fill in a
+//                  sample, from the lower page and the upper pages read
+//                  so far. Lane values only go to the sample: the lane
+//                  columns stop at four lanes, and only the aggregates of
+//                  the samples are published.
+//
+// input: port structure, sample to fill in
+//
+// output: none
+//
+void
+pm_cmis_set_dom(pm_port_t *port, pm_dom_sample_t *sample)
+{
+    const pm_cmis_t     *cmis = port->cmis;
+    const unsigned char *lower = port->dom.page;
+    const unsigned char *image;
+    unsigned char       monitors;
+    unsigned int        multiplier;
+    int                 lane;
+
+    sample->temperature = (int16_t)PM_DOM_RAW16(lower[PM_CMIS_TEMPERATURE],
+                                                lower[PM_CMIS_TEMPERATURE + 1]);
+    sample->vcc = PM_DOM_RAW16(lower[PM_CMIS_VCC], lower[PM_CMIS_VCC + 1]);
+
+    SET_READING_STRING(port, temperature,
+                     sample->temperature * PM_DOM_TEMPERATURE_UNIT);
+    SET_READING_STRING(port, vcc, sample->vcc * PM_DOM_VCC_UNIT);
+
+    pm_dom_set_flags(port, pm_cmis_dom_flags, ARRAY_SIZE(pm_cmis_dom_flags),
+                     lower);
+
+    if (pm_cmis_page_loaded(cmis, PM_CMIS_PAGE_THRESHOLDS)) {
+        image = cmis->pages[PM_CMIS_PAGE_THRESHOLDS];
+
+        SET_FLOAT_STRING(port, temperature_high_alarm_threshold,
+            (int16_t)pm_cmis_word(image, PM_CMIS_TEMPERATURE_THRESHOLDS) *
+            PM_DOM_TEMPERATURE_UNIT);
+        SET_FLOAT_STRING(port, temperature_low_alarm_threshold,
+            (int16_t)pm_cmis_word(image, PM_CMIS_TEMPERATURE_THRESHOLDS + 2) *
+            PM_DOM_TEMPERATURE_UNIT);
+        SET_FLOAT_STRING(port, temperature_high_warning_threshold,
+            (int16_t)pm_cmis_word(image, PM_CMIS_TEMPERATURE_THRESHOLDS + 4) *
+            PM_DOM_TEMPERATURE_UNIT);
+        SET_FLOAT_STRING(port, temperature_low_warning_threshold,
+            (int16_t)pm_cmis_word(image, PM_CMIS_TEMPERATURE_THRESHOLDS + 6) *
+            PM_DOM_TEMPERATURE_UNIT);
+
+        SET_FLOAT_STRING(port, vcc_high_alarm_threshold,
+            pm_cmis_word(image, PM_CMIS_VCC_THRESHOLDS) * PM_DOM_VCC_UNIT);
+        SET_FLOAT_STRING(port, vcc_low_alarm_threshold,
+            pm_cmis_word(image, PM_CMIS_VCC_THRESHOLDS + 2) * PM_DOM_VCC_UNIT);
+        SET_FLOAT_STRING(port, vcc_high_warning_threshold,
+            pm_cmis_word(image, PM_CMIS_VCC_THRESHOLDS + 4) * PM_DOM_VCC_UNIT);
+        SET_FLOAT_STRING(port, vcc_low_warning_threshold,
+            pm_cmis_word(image, PM_CMIS_VCC_THRESHOLDS + 6) * PM_DOM_VCC_UNIT);
+    }
+
+    // lanes count only once the module says it monitors them
+    sample->n_lanes = 0;
+    if (!pm_cmis_page_loaded(cmis, PM_CMIS_PAGE_ADVERTISING) ||
+        !pm_cmis_page_loaded(cmis, PM_CMIS_PAGE_LANES)) {
+        return;
+    }
+
+    monitors = PM_CMIS_UPPER(cmis->pages[PM_CMIS_PAGE_ADVERTISING],
+                             PM_CMIS_LANE_MONITORS);
+    if (0 == (monitors & PM_CMIS_LANE_MONITORS_MASK)) {
+        return;
+    }
+    multiplier = 1u << MIN((monitors >> 3) & 0x3, 2);
+
+    image = cmis->pages[PM_CMIS_PAGE_LANES];
+    sample->n_lanes = PM_CMIS_LANES;
+    sample->has_tx_power = true;
+    for (lane = 0; lane < PM_CMIS_LANES; lane++) {
+        unsigned int bias = pm_cmis_word(image, PM_CMIS_TX_BIAS + 2 * lane);
+
+        sample->tx_bias[lane] = MIN(bias * multiplier, UINT16_MAX);
+        sample->tx_power[lane] = pm_cmis_word(image,
+                                              PM_CMIS_TX_POWER + 2 * lane);
+        sample->rx_power[lane] = pm_cmis_word(image,
+                                              PM_CMIS_RX_POWER + 2 * lane);
+    }
+}
+
+void
+pm_cmis_dump(struct ds *ds, const pm_port_t *port)
+{
+    const pm_cmis_t *cmis = port->cmis;
+    size_t          idx;
+
+    if (NULL == cmis) {
+        return;
+    }
+
+    ds_put_format(ds, "    page selects           = %llu written, "
+                  "%llu skipped\n", cmis->n_selects, cmis->n_skipped);
+    ds_put_cstr(ds, "    upper pages loaded     =");
+    if (cmis->flat) {
+        ds_put_cstr(ds, " none (flat memory)");
+    }
+    for (idx = 0; idx < PM_CMIS_N_PAGES; idx++) {
+        if (pm_cmis_page_loaded(cmis, idx)) {
+            ds_put_format(ds, " %s", pm_cmis_pages[idx].name);
+        }
+    }
+    ds_put_cstr(ds, "\n");
+}
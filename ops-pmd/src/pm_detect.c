@@ -22,18 +22,21 @@
  ***************************************************************************/
 
 #define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
-#include <stdarg.h>
 #include <ctype.h>
 #include <math.h>
 
 #include <vswitch-idl.h>
 #include <openswitch-idl.h>
+#include <util.h>
 
 #include "pmd.h"
 #include "plug.h"
+#include "pm_cmis.h"
 
 VLOG_DEFINE_THIS_MODULE(pm_detect);
 
@@ -75,42 +78,85 @@ hex_to_ascii(char *buf, int buf_size)
     return ascii;
 }
 
-STATIC void
-set_supported_speeds(pm_port_t *port, size_t count, ...)
-{
-    va_list args;
-    size_t idx;
-    int speed;
-    char *speeds = NULL;
-    char *new_speeds = NULL;
+//
+// Module speeds
+//
+// A set of speeds is a mask of PM_SPEED_* bits. Every set has its column
+// value preformatted below, so setting the speed columns is a lookup and
+// a pointer comparison tells whether they changed. A new speed doubles
+// the table.
+//
 
-    va_start(args, count);
-    if (NULL != port->ovs_module_columns.supported_speeds) {
-        free(port->ovs_module_columns.supported_speeds);
-    }
+#define PM_SPEED_1G             0x1u
+#define PM_SPEED_10G            0x2u
+#define PM_SPEED_40G            0x4u
+#define PM_SPEED_100G           0x8u
+#define PM_SPEED_400G           0x10u
+#define PM_SPEED_SETS           0x20u
+
+// supported_speeds of each set, in Mb/s and ascending order; modules of
+// unknown class have none
+static char *const pm_speed_sets[PM_SPEED_SETS] = {
+    [0x00] = "0",
+    [0x01] = "1000",
+    [0x02] = "10000",
+    [0x03] = "1000 10000",
+    [0x04] = "40000",
+    [0x05] = "1000 40000",
+    [0x06] = "10000 40000",
+    [0x07] = "1000 10000 40000",
+    [0x08] = "100000",
+    [0x09] = "1000 100000",
+    [0x0a] = "10000 100000",
+    [0x0b] = "1000 10000 100000",
+    [0x0c] = "40000 100000",
+    [0x0d] = "1000 40000 100000",
+    [0x0e] = "10000 40000 100000",
+    [0x0f] = "1000 10000 40000 100000",
+    [0x10] = "400000",
+    [0x11] = "1000 400000",
+    [0x12] = "10000 400000",
+    [0x13] = "1000 10000 400000",
+    [0x14] = "40000 400000",
+    [0x15] = "1000 40000 400000",
+    [0x16] = "10000 40000 400000",
+    [0x17] = "1000 10000 40000 400000",
+    [0x18] = "100000 400000",
+    [0x19] = "1000 100000 400000",
+    [0x1a] = "10000 100000 400000",
+    [0x1b] = "1000 10000 100000 400000",
+    [0x1c] = "40000 100000 400000",
+    [0x1d] = "1000 40000 100000 400000",
+    [0x1e] = "10000 40000 100000 400000",
+    [0x1f] = "1000 10000 40000 100000 400000",
+};
 
-    for (idx = 0; idx < count; idx++) {
-        speed = va_arg(args, int);
-        asprintf(&new_speeds, "%s%s%d",
-                 (NULL == speeds) ? "" :  speeds,
-                 (0 == idx) ? "" :  " ",
-                 speed);
-        if (speeds != NULL) {
-            free(speeds);
-        }
-        speeds = new_speeds;
+//
+// pm_set_speeds: set the supported_speeds and max_speed columns
+//
+// input: port structure, set of PM_SPEED_* bits
+//
+// output: none
+//
+static void
+pm_set_speeds(pm_port_t *port, unsigned int speeds)
+{
+    unsigned int top = speeds;
+
+    // max_speed is the set of the highest speed alone
+    while (top & (top - 1)) {
+        top &= top - 1;
     }
 
-    va_end(args);
-    port->ovs_module_columns.supported_speeds = speeds;
-    port->module_info_changed = 1;
+    SET_CONST_STRING(port, supported_speeds, pm_speed_sets[speeds]);
+    SET_CONST_STRING(port, max_speed, pm_speed_sets[top]);
 }
 
 //
 // pm_oui_format：将oui数据格式化成字符串，而不是二进制数据
 //
 STATIC void
-pm_oui_format(char *ascii_oui, unsigned char *binary_oui)
+pm_oui_format(char *ascii_oui, const unsigned char *binary_oui)
 {
     snprintf(ascii_oui,
         PM_VENDOR_OUI_LEN*3,
@@ -120,25 +166,343 @@ pm_oui_format(char *ascii_oui, unsigned char *binary_oui)
         binary_oui[2]);
 }
 
+//
+// Module classification
+//
+// A module is classified by the first row of pm_classes that applies to
+// its form factor and whose tests all pass. A test masks one byte of the
+// serial ID and compares it with a value. QSFP offsets are relative to
+// byte 128, where pm_qsfp_serial_id_t starts, which puts the compliance
+// codes of both families at the same offsets.
+//
+
+// serial ID bytes the tests look at
+#define PM_ID_CONNECTOR         offsetof(pm_sfp_serial_id_t, connector)
+#define PM_ID_COMPLIANCE        offsetof(pm_sfp_serial_id_t, transceiver)
+#define PM_ID_EXT_COMPLIANCE    offsetof(pm_qsfp_serial_id_t, options)
+#define PM_ID_CMIS_IDENTIFIER   offsetof(pm_cmis_serial_id_t, identifier)
+#define PM_ID_CMIS_CONNECTOR    offsetof(pm_cmis_serial_id_t, connector)
+#define PM_ID_CMIS_MEDIA_TECH   offsetof(pm_cmis_serial_id_t, \
+                                         media_interface_technology)
+
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_serial_id_t, connector) == PM_ID_CONNECTOR);
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_serial_id_t, spec_compliance) ==
+                  PM_ID_COMPLIANCE);
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_options_t, ext_compliance_code) == 0);
+BUILD_ASSERT_DECL(PM_ID_COMPLIANCE == PM_SFP_ID_TRANSCEIVER);
+BUILD_ASSERT_DECL(PM_SFF_IN(pm_sfp_serial_id_t, transceiver,
+                            PM_SFP_CABLE_ACTIVE_OFFSET));
+
+// a bit of the Nth compliance code byte is set; a byte holds a code
+#define PM_BIT(n, bit)          { PM_ID_COMPLIANCE + (n), 1u << (bit), 1u << (bit) }
+#define PM_CODE(offset, code)   { (offset), 0xff, (code) }
+
+#define PM_FORM(type)           (1u << (type))
+#define PM_FORM_SFP             PM_FORM(MODULE_TYPE_SFP_PLUS)
+#define PM_FORM_QSFP28          PM_FORM(MODULE_TYPE_QSFP28)
+#define PM_FORM_QSFP            (PM_FORM(MODULE_TYPE_QSFP_PLUS) | PM_FORM_QSFP28)
+#define PM_FORM_QSFP_DD         PM_FORM(MODULE_TYPE_QSFP_DD)
+#define PM_FORM_OSFP            PM_FORM(MODULE_TYPE_OSFP)
+
+// connector value of a CMIS module. Until the schema lists these values,
+// CMIS modules are published as unknown and unrecognized.
+#ifdef OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_DD
+#define PM_CMIS_CONNECTOR(name) OVSREC_INTERFACE_PM_INFO_CONNECTOR_##name
+#else
+#define PM_CMIS_CONNECTOR(name) NULL
+#endif
+
+// speed of SFP DACs, which follows their nominal bit rate
+#define PM_SPEED_BIT_RATE       0u
+
+enum pm_cable {
+    PM_CABLE_NONE,                      // no cable columns
+    PM_CABLE_SFP_DAC,                   // technology and length of a DAC
+    PM_CABLE_CMIS_DAC,                  // the same for a CMIS DAC
+};
+
+typedef struct {
+    unsigned int    forms;              // PM_FORM_* the row applies to
+    struct {
+        uint8_t     offset;
+        uint8_t     mask;               // 0 for an unused test
+        uint8_t     value;
+    } tests[2];
+    const char      *name;              // for logging
+    char            *connector;         // NULL if unsupported
+    bool            optical;
+    unsigned int    speeds;             // PM_SPEED_* bits, or
+                                        // PM_SPEED_BIT_RATE
+    enum pm_cable   cable;
+} pm_class_t;
+
+static const pm_class_t pm_classes[] = {
+    // SFP+
+    { PM_FORM_SFP, { PM_CODE(PM_ID_CONNECTOR, PM_CONNECTOR_COPPER_PIGTAIL) },
+      "DAC", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_DAC,
+      false, PM_SPEED_BIT_RATE, PM_CABLE_SFP_DAC },
+    { PM_FORM_SFP, { PM_BIT(3, 0) },
+      "1G_SX", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_SX, true, PM_SPEED_1G },
+    { PM_FORM_SFP, { PM_BIT(3, 1) },
+      "1G_LX", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_LX, true, PM_SPEED_1G },
+    { PM_FORM_SFP, { PM_BIT(3, 2) },
+      "1G_CX", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_CX, false, PM_SPEED_1G },
+    { PM_FORM_SFP, { PM_BIT(3, 3) },
+      "1G RJ45", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_RJ45,
+      false, PM_SPEED_1G },
+    { PM_FORM_SFP, { PM_BIT(0, 4) },
+      "10G SR", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_SR,
+      true, PM_SPEED_10G },
+    { PM_FORM_SFP, { PM_BIT(0, 5) },
+      "10G LR", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_LR,
+      true, PM_SPEED_10G },
+    { PM_FORM_SFP, { PM_BIT(0, 6) },
+      "10G LRM", OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_LRM,
+      true, PM_SPEED_10G },
+
+    // QSFP28 extended compliance codes; a module with an unknown one is
+    // not looked at as a 40G module
+    { PM_FORM_QSFP28, { PM_BIT(0, 7), PM_CODE(PM_ID_EXT_COMPLIANCE,
+                        PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_SR4) },
+      "100G_SR4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_SR4,
+      true, PM_SPEED_100G },
+    { PM_FORM_QSFP28, { PM_BIT(0, 7), PM_CODE(PM_ID_EXT_COMPLIANCE,
+                        PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_LR4) },
+      "100G_LR4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_LR4,
+      true, PM_SPEED_100G },
+    { PM_FORM_QSFP28, { PM_BIT(0, 7), PM_CODE(PM_ID_EXT_COMPLIANCE,
+                        PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_CWDM4) },
+      "100G_CWDM4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_CWDM4,
+      true, PM_SPEED_100G },
+    { PM_FORM_QSFP28, { PM_BIT(0, 7), PM_CODE(PM_ID_EXT_COMPLIANCE,
+                        PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_PSM4) },
+      "100G_PSM4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_PSM4,
+      true, PM_SPEED_100G },
+    { PM_FORM_QSFP28, { PM_BIT(0, 7), PM_CODE(PM_ID_EXT_COMPLIANCE,
+                        PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_CR4) },
+      "100G_CR4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_CR4,
+      false, PM_SPEED_100G },
+    { PM_FORM_QSFP28, { PM_BIT(0, 7), PM_CODE(PM_ID_EXT_COMPLIANCE,
+                        PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_CLR4) },
+      "100G_CLR4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_CLR4,
+      true, PM_SPEED_100G },
+    { PM_FORM_QSFP28, { PM_BIT(0, 7) }, "unsupported", NULL },
+
+    // QSFP+, and QSFP28 without extended compliance
+    { PM_FORM_QSFP, { PM_BIT(0, 1) },
+      "40G_LR4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_LR4,
+      true, PM_SPEED_40G },
+    { PM_FORM_QSFP, { PM_BIT(0, 2) },
+      "40G_SR4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_SR4,
+      true, PM_SPEED_40G },
+    { PM_FORM_QSFP, { PM_BIT(0, 3) },
+      "40G_CR4", OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_CR4,
+      false, PM_SPEED_40G },
+
+    // CMIS; the identifier tells a CMIS module from a QSFP28 one plugged
+    // into the same cage, which is not supported
+    { PM_FORM_QSFP_DD, { PM_CODE(PM_ID_CMIS_IDENTIFIER, PM_CMIS_ID_QSFP_DD),
+                         PM_CODE(PM_ID_CMIS_CONNECTOR,
+                                 PM_CONNECTOR_COPPER_PIGTAIL) },
+      "400G_CR8", PM_CMIS_CONNECTOR(QSFP_DD_CR8),
+      false, PM_SPEED_400G, PM_CABLE_CMIS_DAC },
+    { PM_FORM_QSFP_DD, { PM_CODE(PM_ID_CMIS_IDENTIFIER, PM_CMIS_ID_QSFP_DD),
+                         PM_CODE(PM_ID_CMIS_MEDIA_TECH,
+                                 PM_CMIS_MEDIA_TECH_850NM_VCSEL) },
+      "400G_SR8", PM_CMIS_CONNECTOR(QSFP_DD_SR8),
+      true, PM_SPEED_400G },
+    { PM_FORM_QSFP_DD, { PM_CODE(PM_ID_CMIS_IDENTIFIER, PM_CMIS_ID_QSFP_DD) },
+      "400G", PM_CMIS_CONNECTOR(QSFP_DD),
+      true, PM_SPEED_400G },
+    { PM_FORM_OSFP, { PM_CODE(PM_ID_CMIS_IDENTIFIER, PM_CMIS_ID_OSFP),
+                      PM_CODE(PM_ID_CMIS_CONNECTOR,
+                              PM_CONNECTOR_COPPER_PIGTAIL) },
+      "400G_CR8", PM_CMIS_CONNECTOR(OSFP_CR8),
+      false, PM_SPEED_400G, PM_CABLE_CMIS_DAC },
+    { PM_FORM_OSFP, { PM_CODE(PM_ID_CMIS_IDENTIFIER, PM_CMIS_ID_OSFP),
+                      PM_CODE(PM_ID_CMIS_MEDIA_TECH,
+                              PM_CMIS_MEDIA_TECH_850NM_VCSEL) },
+      "400G_SR8", PM_CMIS_CONNECTOR(OSFP_SR8),
+      true, PM_SPEED_400G },
+    { PM_FORM_OSFP, { PM_CODE(PM_ID_CMIS_IDENTIFIER, PM_CMIS_ID_OSFP) },
+      "400G", PM_CMIS_CONNECTOR(OSFP),
+      true, PM_SPEED_400G },
+};
+
+static const pm_class_t pm_class_unknown = { .name = "unrecognized" };
+
+//
+// pm_classify: find the class of a module in pm_classes
+//
+// input: module type (MODULE_TYPE_*), serial ID
+//
+// output: matching row, or pm_class_unknown
+//
+static const pm_class_t *
+pm_classify(int type, const unsigned char *id)
+{
+    const pm_class_t *cls;
+    size_t idx;
+
+    for (cls = pm_classes; cls < &pm_classes[ARRAY_SIZE(pm_classes)]; cls++) {
+        if (0 == (cls->forms & PM_FORM(type))) {
+            continue;
+        }
+        for (idx = 0; idx < ARRAY_SIZE(cls->tests); idx++) {
+            if ((id[cls->tests[idx].offset] & cls->tests[idx].mask) !=
+                cls->tests[idx].value) {
+                break;
+            }
+        }
+        if (ARRAY_SIZE(cls->tests) == idx) {
+            return cls;
+        }
+    }
+
+    return &pm_class_unknown;
+}
+
+//
+// pm_set_class: fill in the columns that follow from a module's class
+//
+// input: port structure, class, serial ID
+//
+// output: none
+//
+static void
+pm_set_class(pm_port_t *port, const pm_class_t *cls,
+             const pm_sfp_serial_id_t *serial_datap)
+{
+    unsigned int    speeds = cls->speeds;
+
+    VLOG_DBG("module is %s: %s", cls->name, port->instance);
+
+    port->optical = cls->optical;
+    if (NULL != cls->connector) {
+        SET_CONST_STRING(port, connector, cls->connector);
+        SET_CONST_STRING(port, connector_status,
+                         OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
+    } else {
+        SET_CONST_STRING(port, connector,
+                         OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
+        SET_CONST_STRING(port, connector_status,
+                         OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
+    }
+
+    // an unrecognized module has no speeds
+    if (NULL == cls->connector) {
+        speeds = 0;
+    } else if (PM_SPEED_BIT_RATE == speeds) {
+        speeds = (serial_datap->bit_rate_nominal >= SFP_BIT_RATE_NOMINAL_10G) ?
+                 PM_SPEED_10G : PM_SPEED_1G;
+    }
+    pm_set_speeds(port, speeds);
+}
+
+//
+// pm_id_string: copy a serial ID text field, stripping trailing spaces
+//
+// input: buffer of len + 1 bytes, field, field length
+//
+// output: buffer
+//
+static char *
+pm_id_string(char *buf, const unsigned char *field, size_t len)
+{
+    memcpy(buf, field, len);
+    buf[len] = 0;
+    while (len > 1 && SPACE == buf[len - 1]) {
+        buf[--len] = 0;
+    }
+
+    return buf;
+}
+
+//
+// pm_module_type: module type of a port's connector
+//
+// input: connector of the port, as in the hw description
+//
+// output: MODULE_TYPE_*, or -1 if the connector is not a known one
+//
+static int
+pm_module_type(const char *connector)
+{
+    if (strcmp(connector, CONNECTOR_SFP_PLUS) == 0) {
+        return MODULE_TYPE_SFP_PLUS;
+    } else if (strcmp(connector, CONNECTOR_QSFP_PLUS) == 0) {
+        return MODULE_TYPE_QSFP_PLUS;
+    } else if (strcmp(connector, CONNECTOR_QSFP28) == 0) {
+        return MODULE_TYPE_QSFP28;
+    } else if (strcmp(connector, CONNECTOR_QSFP_DD) == 0) {
+        return MODULE_TYPE_QSFP_DD;
+    } else if (strcmp(connector, CONNECTOR_OSFP) == 0) {
+        return MODULE_TYPE_OSFP;
+    }
+    return -1;
+}
+
+// vendor fields of a serial ID, which sit at different offsets in SFP+,
+// QSFP and CMIS IDs
+typedef struct {
+    const unsigned char *name;
+    const unsigned char *oui;
+    const unsigned char *part_number;
+    const unsigned char *revision;
+    size_t              revision_len;
+    const unsigned char *serial_number;
+    size_t              size;           // of the ID, as published in a0
+} pm_id_fields_t;
+
+static void
+pm_id_fields(int type, const pm_sfp_serial_id_t *serial_datap,
+             pm_id_fields_t *fields)
+{
+    const pm_qsfp_serial_id_t *qsfpp_serial_id;
+    const pm_cmis_serial_id_t *cmis_serial_id;
+
+    if (MODULE_TYPE_SFP_PLUS == type) {
+        fields->name = serial_datap->vendor_name;
+        fields->oui = serial_datap->vendor_oui;
+        fields->part_number = serial_datap->vendor_part_number;
+        fields->revision = serial_datap->vendor_revision;
+        fields->revision_len = PM_SFP_VENDOR_REV_LEN;
+        fields->serial_number = serial_datap->vendor_serial_number;
+        fields->size = sizeof(pm_sfp_serial_id_t);
+    } else if (MODULE_TYPE_QSFP_DD == type || MODULE_TYPE_OSFP == type) {
+        cmis_serial_id = (const pm_cmis_serial_id_t *)serial_datap;
+        fields->name = cmis_serial_id->vendor_name;
+        fields->oui = cmis_serial_id->vendor_oui;
+        fields->part_number = cmis_serial_id->vendor_part_number;
+        fields->revision = cmis_serial_id->vendor_revision;
+        fields->revision_len = PM_QSFP_VENDOR_REV_LEN;
+        fields->serial_number = cmis_serial_id->vendor_serial_number;
+        fields->size = sizeof(pm_cmis_serial_id_t);
+    } else {
+        qsfpp_serial_id = (const pm_qsfp_serial_id_t *)serial_datap;
+        fields->name = qsfpp_serial_id->vendor_name;
+        fields->oui = qsfpp_serial_id->vendor_oui;
+        fields->part_number = qsfpp_serial_id->vendor_part_number;
+        fields->revision = qsfpp_serial_id->vendor_revision;
+        fields->revision_len = PM_QSFP_VENDOR_REV_LEN;
+        fields->serial_number = qsfpp_serial_id->vendor_serial_number;
+        fields->size = sizeof(pm_qsfp_serial_id_t);
+    }
+}
+
 //
 // pm_parse：从串行ID数据中获取重要数据
 //
+// Only the columns every update needs are set here: connector, status,
+// speeds and the optical flag. The rest are decoded from the page kept in
+// the port when asked for (see pm_decode_details).
+//
 int
 pm_parse(
     pm_sfp_serial_id_t  *serial_datap,
     pm_port_t           *port)
 {
     int                     type;
-    char                    vendor_name[PM_VENDOR_NAME_LEN+1];
-    char                    vendor_part_number[PM_VENDOR_PN_LEN+1];
-    char                    vendor_revision[PM_SFP_VENDOR_REV_LEN+1];
-    char                    vendor_serial_number[PM_VENDOR_SN_LEN+1];
-    char                    vendor_oui[PM_VENDOR_OUI_LEN*3];
-    size_t                  idx;
-    pm_qsfp_serial_id_t*    qsfpp_serial_id;
-
-VLOG_WARN("w %s(%d): port=%s, pluggable=%d, connector=%s", __FUNCTION__, __LINE__, port->instance, 
-    port->module_device->pluggable, port->module_device->connector);
 
 //忽略不可插拔的模块
     if (false == port->module_device->pluggable) {
@@ -153,13 +517,8 @@ VLOG_WARN("w %s(%d): port=%s, pluggable=%d, connector=%s", __FUNCTION__, __LINE_
     }
 
     //准备处理SFP +，QSFP +和QSFP28不同
-    if (strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS) == 0) {
-        type = MODULE_TYPE_SFP_PLUS;
-    } else if (strcmp(port->module_device->connector, CONNECTOR_QSFP_PLUS) == 0) {
-        type = MODULE_TYPE_QSFP_PLUS;
-    } else if (strcmp(port->module_device->connector, CONNECTOR_QSFP28) == 0) {
-        type = MODULE_TYPE_QSFP28;
-    } else {
+    type = pm_module_type(port->module_device->connector);
+    if (type < 0) {
         VLOG_WARN("unknown connector type for port: %s (%s)",
                   port->instance, port->module_device->connector);
         pm_delete_all_data(port);
@@ -167,539 +526,215 @@ VLOG_WARN("w %s(%d): port=%s, pluggable=%d, connector=%s", __FUNCTION__, __LINE_
         return -1;
     }
 
-VLOG_WARN("w %s(%d): port=%s, connector=0x%X, type=%d, 10G=%d", __FUNCTION__, __LINE__, port->instance, 
-    serial_datap->connector, type, serial_datap->transceiver.enet_10gbase_sr);
-    
-    serial_datap->transceiver.enet_10gbase_sr = 1;
-    
-    switch (type) {
-        case MODULE_TYPE_SFP_PLUS:
-            VLOG_WARN("port is SFP plus pluggable: %s", port->instance);
-            //支持的SFP模块类型
-            if (PM_CONNECTOR_COPPER_PIGTAIL == serial_datap->connector && false) {
-                unsigned int speed = 0;
-                char *cable_tech = OVSREC_INTERFACE_PM_INFO_CABLE_TECHNOLOGY_PASSIVE;
-                port->optical = false;
-
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_DAC);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                VLOG_WARN("bit rate for %s is 0x%x",
-                         port->instance, serial_datap->bit_rate_nominal);
-                if (serial_datap->bit_rate_nominal >= SFP_BIT_RATE_NOMINAL_10G) {
-                    speed = 10000;
-                } else {
-                    speed = 1000;
-                }
-                VLOG_WARN("module is DAC at %d: %s", speed, port->instance);
-                SET_INT_STRING(port, max_speed, speed);
-                set_supported_speeds(port, 1, speed);
-                //确定主动/被动
-                if (0 != serial_datap->transceiver.cable_technology_active) {
-                    cable_tech = OVSREC_INTERFACE_PM_INFO_CABLE_TECHNOLOGY_ACTIVE;
-                } else if (0 != serial_datap->transceiver.cable_technology_passive) {
-                    cable_tech = OVSREC_INTERFACE_PM_INFO_CABLE_TECHNOLOGY_PASSIVE;
-                }
-                SET_STATIC_STRING(port, cable_technology, cable_tech);
-                SET_INT_STRING(port, cable_length, serial_datap->length_copper);
-            } else if (0 != serial_datap->transceiver.enet_1000base_sx && false) {
-                VLOG_WARN("module is 1G_SX: %s", port->instance);
-                //处理sx类型
-                port->optical = true;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_SX);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 1000);
-                set_supported_speeds(port, 1, 1000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != serial_datap->transceiver.enet_1000base_lx && false) {
-                // handle lx type
-                VLOG_WARN("module is 1G_LX: %s", port->instance);
-                port->optical = true;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_LX);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 1000);
-                set_supported_speeds(port, 1, 1000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != serial_datap->transceiver.enet_1000base_cx && false) {
-                // handle cx type
-                port->optical = false;
-                VLOG_WARN("module is 1G_CX: %s", port->instance);
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_CX);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 1000);
-                set_supported_speeds(port, 1, 1000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != serial_datap->transceiver.enet_1000base_t && false) {
-                // handle RJ45 type
-                port->optical = false;
-                VLOG_WARN("module is 1G RJ45: %s", port->instance);
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_RJ45);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 1000);
-                set_supported_speeds(port, 1, 1000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != serial_datap->transceiver.enet_10gbase_sr || true) {
-                // handle sr type
-                VLOG_WARN("module is 10G SR: %s", port->instance);
-                port->optical = true;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_SR);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 10000);
-                set_supported_speeds(port, 1, 10000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != serial_datap->transceiver.enet_10gbase_lr) {
-                VLOG_WARN("module is 10G LR: %s", port->instance);
-                port->optical = true;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_LR);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 10000);
-                set_supported_speeds(port, 1, 10000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != serial_datap->transceiver.enet_10gbase_lrm) {
-                VLOG_WARN("module is 10G LRM: %s", port->instance);
-                port->optical = true;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_SFP_LRM);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 10000);
-                set_supported_speeds(port, 1, 10000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else {
-                VLOG_WARN("module is unrecognized: %s", port->instance);
-                port->optical = false;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
-                SET_INT_STRING(port, max_speed, 0);
-                set_supported_speeds(port, 1, 0);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            }
-            //填写其余的数据
-            DELETE(port, power_mode);
-
-            // 供应商名称
-            memcpy(vendor_name, "vendor_name", PM_VENDOR_NAME_LEN);
-            vendor_name[PM_VENDOR_NAME_LEN] = 0;
-            //带走尾随空格
-            idx = PM_VENDOR_NAME_LEN - 1;
-            while (idx > 0 && SPACE == vendor_name[idx]) {
-                vendor_name[idx] = 0;
-                idx--;
-            }
-
-            SET_STRING(port, vendor_name, vendor_name);
-
-/*
-            // vendor_oui
-            pm_oui_format(vendor_oui, serial_datap->vendor_oui);
-
-            SET_STRING(port, vendor_oui, vendor_oui);
-*/
-            // vendor_part_number
-            memcpy(vendor_part_number, "vendor_part_number", PM_VENDOR_PN_LEN);
-            vendor_part_number[PM_VENDOR_PN_LEN] = 0;
-            // strip trailing spaces
-            idx = PM_VENDOR_PN_LEN - 1;
-            while (idx > 0 && SPACE == vendor_part_number[idx]) {
-                vendor_part_number[idx] = 0;
-                idx--;
-            }
-
-            SET_STRING(port, vendor_part_number, vendor_part_number);
-
-            // vendor_revision
-            memcpy(vendor_revision, "rev", PM_SFP_VENDOR_REV_LEN);
-            vendor_revision[PM_SFP_VENDOR_REV_LEN] = 0;
-            //带走尾随空格
-            idx = PM_SFP_VENDOR_REV_LEN - 1;
-            while (idx > 0 && SPACE == vendor_revision[idx]) {
-                vendor_revision[idx] = 0;
-                idx--;
-            }
+    VLOG_DBG("port is %s pluggable: %s", port->module_device->connector,
+             port->instance);
 
-            SET_STRING(port, vendor_revision, vendor_revision);
+    pm_set_class(port, pm_classify(type, (const unsigned char *)serial_datap),
+                 serial_datap);
 
-            // vendor_serial_number
-            memcpy(vendor_serial_number, "serial_number", PM_VENDOR_SN_LEN);
-            vendor_serial_number[PM_VENDOR_SN_LEN] = 0;
-            //带走尾随空格
-            idx = PM_VENDOR_SN_LEN - 1;
-            while (idx > 0 && SPACE == vendor_serial_number[idx]) {
-                vendor_serial_number[idx] = 0;
-                idx--;
-            }
-
-            SET_STRING(port, vendor_serial_number, vendor_serial_number);
-
-            // a0
-            SET_BINARY(port, a0, (char *) serial_datap, sizeof(pm_sfp_serial_id_t));
-            break;
-        case MODULE_TYPE_QSFP_PLUS:
-
-            // QSFP具有不同的结构定义（类似但不是）
-                         // 一样）
-            VLOG_DBG("port is QSFP plus pluggable: %s", port->instance);
-
-            qsfpp_serial_id = (pm_qsfp_serial_id_t *)serial_datap;
-
-            if (0 != qsfpp_serial_id->spec_compliance.enet_40gbase_lr4) {
-                VLOG_DBG("module is 40G_LR4: %s", port->instance);
-                // handle LR4 type
-                port->optical = true;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_LR4);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 40000);
-                set_supported_speeds(port, 1, 40000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != qsfpp_serial_id->spec_compliance.enet_40gbase_sr4) {
-                VLOG_DBG("module is 40G_SR4: %s", port->instance);
-                // handle SR4 type
-                port->optical = true;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_SR4);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 40000);
-                set_supported_speeds(port, 1, 40000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else if (0 != qsfpp_serial_id->spec_compliance.enet_40gbase_cr4) {
-                VLOG_DBG("module is 40G_CR4: %s", port->instance);
-                // handle CR4 type
-                port->optical = false;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_CR4);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                SET_INT_STRING(port, max_speed, 40000);
-                set_supported_speeds(port, 1, 40000);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            } else {
-                VLOG_DBG("module is unsupported: %s", port->instance);
-                port->optical = false;
-                SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
-                SET_STATIC_STRING(port, connector_status,
-                                  OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
-                SET_INT_STRING(port, max_speed, 0);
-                set_supported_speeds(port, 1, 0);
-                DELETE(port, cable_technology);
-                DELETE_FREE(port, cable_length);
-            }
-            //填写其余的数据
-                         // OPS_TODO：填写电源模式
-            DELETE(port, power_mode);
-
-            // 供应商名称
-            memcpy(vendor_name, qsfpp_serial_id->vendor_name, PM_VENDOR_NAME_LEN);
-            vendor_name[PM_VENDOR_NAME_LEN] = 0;
-            //带走尾随空格
-            idx = PM_VENDOR_NAME_LEN - 1;
-            while (idx > 0 && SPACE == vendor_name[idx]) {
-                vendor_name[idx] = 0;
-                idx--;
-            }
-
-            SET_STRING(port, vendor_name, vendor_name);
-
-            // vendor_oui
-            pm_oui_format(vendor_oui, qsfpp_serial_id->vendor_oui);
-
-            SET_STRING(port, vendor_oui, vendor_oui);
+    return 0;
+} // pm_parse
 
-            // vendor_part_number
-            memcpy(vendor_part_number, qsfpp_serial_id->vendor_part_number, PM_VENDOR_PN_LEN);
-            vendor_part_number[PM_VENDOR_PN_LEN] = 0;
-            // strip trailing spaces
-            idx = PM_VENDOR_PN_LEN - 1;
-            while (idx > 0 && SPACE == vendor_part_number[idx]) {
-                vendor_part_number[idx] = 0;
-                idx--;
-            }
+//
+// pm_cmis_cable_length: length of a CMIS cable assembly in whole meters
+//
+// input: cable length byte of upper page 00h
+//
+// output: length
+//
+static int
+pm_cmis_cable_length(unsigned char length)
+{
+    static const int tenths[] = { 1, 10, 100, 1000 };
 
-            SET_STRING(port, vendor_part_number, vendor_part_number);
+    return (PM_CMIS_CABLE_LENGTH(length) *
+            tenths[PM_CMIS_CABLE_MULTIPLIER(length)] + 5) / 10;
+}
 
-            // vendor_revision
-            memcpy(vendor_revision, qsfpp_serial_id->vendor_revision, PM_QSFP_VENDOR_REV_LEN);
-            vendor_revision[PM_QSFP_VENDOR_REV_LEN] = 0;
-            // strip trailing spaces
-            idx = PM_QSFP_VENDOR_REV_LEN - 1;
-            while (idx > 0 && SPACE == vendor_revision[idx]) {
-                vendor_revision[idx] = 0;
-                idx--;
-            }
+//
+// pm_decode_details: decode the columns few consumers need (cable,
+//                    power mode, vendor fields, raw page) from the serial
+//                    ID page of a port, unless done since it was read
+//
+// input: port structure
+//
+// output: none
+//
+void
+pm_decode_details(pm_port_t *port)
+{
+    const pm_sfp_serial_id_t *serial_datap;
+    const pm_cmis_serial_id_t *cmis_serial_id;
+    pm_id_fields_t          fields;
+    enum pm_cable           cable;
+    char                    *cable_tech;
+    char                    vendor_name[PM_VENDOR_NAME_LEN+1];
+    char                    vendor_part_number[PM_VENDOR_PN_LEN+1];
+    char                    vendor_revision[PM_SFP_VENDOR_REV_LEN+1];
+    char                    vendor_serial_number[PM_VENDOR_SN_LEN+1];
+    char                    vendor_oui[PM_VENDOR_OUI_LEN*3];
+    bool                    changed = port->module_info_changed;
+    int                     type;
 
-            SET_STRING(port, vendor_revision, vendor_revision);
+    if (port->details_valid || !port->present || port->retry ||
+        NULL == port->module_device->connector) {
+        return;
+    }
+    type = pm_module_type(port->module_device->connector);
+    if (type < 0) {
+        return;
+    }
+    port->details_valid = true;
 
-            // vendor_serial_number
-            memcpy(vendor_serial_number, qsfpp_serial_id->vendor_serial_number, PM_VENDOR_SN_LEN);
-            vendor_serial_number[PM_VENDOR_SN_LEN] = 0;
-            //带走尾随空格
-            idx = PM_VENDOR_SN_LEN - 1;
-            while (idx > 0 && SPACE == vendor_serial_number[idx]) {
-                vendor_serial_number[idx] = 0;
-                idx--;
-            }
+    serial_datap = (const pm_sfp_serial_id_t *)port->serial_id;
 
-            SET_STRING(port, vendor_serial_number, vendor_serial_number);
-
-            // a0
-            SET_BINARY(port, a0, (char *) qsfpp_serial_id, sizeof(pm_qsfp_serial_id_t));
-            break;
-        case MODULE_TYPE_QSFP28:
-
-            //使用与MODULE_TYPE_QSFP_PLUS情况相同的结构定义
-            VLOG_DBG("port is QSFP 28 pluggable: %s", port->instance);
-
-            qsfpp_serial_id = (pm_qsfp_serial_id_t *)serial_datap;
-
-            if (0 != qsfpp_serial_id->spec_compliance.enet_extended) {
-                switch (qsfpp_serial_id->options.ext_compliance_code) {
-                    case PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_SR4:
-                        VLOG_DBG("module is 100G_SR4: %s", port->instance);
-                        // handle SR4 type
-                        port->optical = true;
-                        SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_SR4);
-                        SET_STATIC_STRING(port, connector_status,
-                                          OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                        SET_INT_STRING(port, max_speed, 100000);
-                        set_supported_speeds(port, 1, 100000);
-                        DELETE(port, cable_technology);
-                        DELETE_FREE(port, cable_length);
-                        break;
-                    case PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_LR4:
-                        VLOG_DBG("module is 100G_LR4: %s", port->instance);
-                        // handle LR4 type
-                        port->optical = true;
-                        SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_LR4);
-                        SET_STATIC_STRING(port, connector_status,
-                                          OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                        SET_INT_STRING(port, max_speed, 100000);
-                        set_supported_speeds(port, 1, 100000);
-                        DELETE(port, cable_technology);
-                        DELETE_FREE(port, cable_length);
-                        break;
-                    case PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_CWDM4:
-                        VLOG_DBG("module is 100G_CWDM4: %s", port->instance);
-                        // handle CWDM4 type
-                        port->optical = true;
-                        SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_CWDM4);
-                        SET_STATIC_STRING(port, connector_status,
-                                          OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                        SET_INT_STRING(port, max_speed, 100000);
-                        set_supported_speeds(port, 1, 100000);
-                        DELETE(port, cable_technology);
-                        DELETE_FREE(port, cable_length);
-                        break;
-                    case PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_PSM4:
-                        VLOG_DBG("module is 100G_PSM4: %s", port->instance);
-                        // handle PSM4 type
-                        port->optical = true;
-                        SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_PSM4);
-                        SET_STATIC_STRING(port, connector_status,
-                                          OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                        SET_INT_STRING(port, max_speed, 100000);
-                        set_supported_speeds(port, 1, 100000);
-                        DELETE(port, cable_technology);
-                        DELETE_FREE(port, cable_length);
-                        break;
-                    case PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_CR4:
-                        VLOG_DBG("module is 100G_CR4: %s", port->instance);
-                        // handle CR4 type
-                        port->optical = false;
-                        SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_CR4);
-                        SET_STATIC_STRING(port, connector_status,
-                                          OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                        SET_INT_STRING(port, max_speed, 100000);
-                        set_supported_speeds(port, 1, 100000);
-                        DELETE(port, cable_technology);
-                        DELETE_FREE(port, cable_length);
-                        break;
-                    case PM_QSFP_EXT_COMPLIANCE_CODE_100GBASE_CLR4:
-                        VLOG_DBG("module is 100G_CLR4: %s", port->instance);
-                        // handle CLR4 type
-                        port->optical = true;
-                        SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP28_CLR4);
-                        SET_STATIC_STRING(port, connector_status,
-                                          OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                        SET_INT_STRING(port, max_speed, 100000);
-                        set_supported_speeds(port, 1, 100000);
-                        DELETE(port, cable_technology);
-                        DELETE_FREE(port, cable_length);
-                        break;
-                    default:
-                        VLOG_DBG("module is unsupported: %s", port->instance);
-                        port->optical = false;
-                        SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
-                        SET_STATIC_STRING(port, connector_status,
-                                          OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
-                        SET_INT_STRING(port, max_speed, 0);
-                        set_supported_speeds(port, 1, 0);
-                        DELETE(port, cable_technology);
-                        DELETE_FREE(port, cable_length);
-                        break;
-                }
-            } else {
-                if (0 != qsfpp_serial_id->spec_compliance.enet_40gbase_lr4) {
-                    VLOG_DBG("module is 40G_LR4: %s", port->instance);
-                    // handle LR4 type
-                    port->optical = true;
-                    SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_LR4);
-                    SET_STATIC_STRING(port, connector_status,
-                                      OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                    SET_INT_STRING(port, max_speed, 40000);
-                    set_supported_speeds(port, 1, 40000);
-                    DELETE(port, cable_technology);
-                    DELETE_FREE(port, cable_length);
-                } else if (0 != qsfpp_serial_id->spec_compliance.enet_40gbase_sr4) {
-                    VLOG_DBG("module is 40G_SR4: %s", port->instance);
-                    // handle SR4 type
-                    port->optical = true;
-                    SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_SR4);
-                    SET_STATIC_STRING(port, connector_status,
-                                      OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                    SET_INT_STRING(port, max_speed, 40000);
-                    set_supported_speeds(port, 1, 40000);
-                    DELETE(port, cable_technology);
-                    DELETE_FREE(port, cable_length);
-                } else if (0 != qsfpp_serial_id->spec_compliance.enet_40gbase_cr4) {
-                    VLOG_DBG("module is 40G_CR4: %s", port->instance);
-                    // handle CR4 type
-                    port->optical = false;
-                    SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_QSFP_CR4);
-                    SET_STATIC_STRING(port, connector_status,
-                                      OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_SUPPORTED);
-                    SET_INT_STRING(port, max_speed, 40000);
-                    set_supported_speeds(port, 1, 40000);
-                    DELETE(port, cable_technology);
-                    DELETE_FREE(port, cable_length);
-                } else {
-                    VLOG_DBG("module is unsupported: %s", port->instance);
-                    port->optical = false;
-                    SET_STATIC_STRING(port, connector, OVSREC_INTERFACE_PM_INFO_CONNECTOR_UNKNOWN);
-                    SET_STATIC_STRING(port, connector_status,
-                                      OVSREC_INTERFACE_PM_INFO_CONNECTOR_STATUS_UNRECOGNIZED);
-                    SET_INT_STRING(port, max_speed, 0);
-                    set_supported_speeds(port, 1, 0);
-                    DELETE(port, cable_technology);
-                    DELETE_FREE(port, cable_length);
-                }
-            }
-            //填写其余的数据
-                         // OPS_TODO：填写电源模式
-            DELETE(port, power_mode);
-
-            // 供应商名称
-            memcpy(vendor_name, qsfpp_serial_id->vendor_name, PM_VENDOR_NAME_LEN);
-            vendor_name[PM_VENDOR_NAME_LEN] = 0;
-            //带走尾随空格
-            idx = PM_VENDOR_NAME_LEN - 1;
-            while (idx > 0 && SPACE == vendor_name[idx]) {
-                vendor_name[idx] = 0;
-                idx--;
-            }
+    cable = pm_classify(type, port->serial_id)->cable;
+    if (PM_CABLE_SFP_DAC == cable) {
+        cable_tech = OVSREC_INTERFACE_PM_INFO_CABLE_TECHNOLOGY_PASSIVE;
+        if (PM_SFF_TEST(serial_datap, PM_SFP_CABLE_ACTIVE)) {
+            cable_tech = OVSREC_INTERFACE_PM_INFO_CABLE_TECHNOLOGY_ACTIVE;
+        }
+        SET_CONST_STRING(port, cable_technology, cable_tech);
+        SET_INT_STRING(port, cable_length, serial_datap->length_copper);
+    } else if (PM_CABLE_CMIS_DAC == cable) {
+        cmis_serial_id = (const pm_cmis_serial_id_t *)port->serial_id;
+        cable_tech = OVSREC_INTERFACE_PM_INFO_CABLE_TECHNOLOGY_PASSIVE;
+        if (cmis_serial_id->media_interface_technology >=
+            PM_CMIS_MEDIA_TECH_COPPER_ACTIVE) {
+            cable_tech = OVSREC_INTERFACE_PM_INFO_CABLE_TECHNOLOGY_ACTIVE;
+        }
+        SET_CONST_STRING(port, cable_technology, cable_tech);
+        SET_INT_STRING(port, cable_length,
+                       pm_cmis_cable_length(cmis_serial_id->cable_length));
+    } else {
+        DELETE(port, cable_technology);
+        DELETE_FREE(port, cable_length);
+    }
 
-            SET_STRING(port, vendor_name, vendor_name);
+    // OPS_TODO：填写电源模式
+    DELETE(port, power_mode);
 
-            // vendor_oui
-            pm_oui_format(vendor_oui, qsfpp_serial_id->vendor_oui);
+    pm_id_fields(type, serial_datap, &fields);
 
-            SET_STRING(port, vendor_oui, vendor_oui);
+    pm_id_string(vendor_name, fields.name, PM_VENDOR_NAME_LEN);
+    SET_INTERN_STRING(port, vendor_name, vendor_name);
 
-            // vendor_part_number
-            memcpy(vendor_part_number, qsfpp_serial_id->vendor_part_number, PM_VENDOR_PN_LEN);
-            vendor_part_number[PM_VENDOR_PN_LEN] = 0;
-            // strip trailing spaces
-            idx = PM_VENDOR_PN_LEN - 1;
-            while (idx > 0 && SPACE == vendor_part_number[idx]) {
-                vendor_part_number[idx] = 0;
-                idx--;
-            }
+    pm_oui_format(vendor_oui, fields.oui);
+    SET_INTERN_STRING(port, vendor_oui, vendor_oui);
 
-            SET_STRING(port, vendor_part_number, vendor_part_number);
+    pm_id_string(vendor_part_number, fields.part_number, PM_VENDOR_PN_LEN);
+    SET_INTERN_STRING(port, vendor_part_number, vendor_part_number);
 
-            // vendor_revision
-            memcpy(vendor_revision, qsfpp_serial_id->vendor_revision, PM_QSFP_VENDOR_REV_LEN);
-            vendor_revision[PM_QSFP_VENDOR_REV_LEN] = 0;
-            //带走尾随空格
-            idx = PM_QSFP_VENDOR_REV_LEN - 1;
-            while (idx > 0 && SPACE == vendor_revision[idx]) {
-                vendor_revision[idx] = 0;
-                idx--;
-            }
+    pm_id_string(vendor_revision, fields.revision, fields.revision_len);
+    SET_INLINE_STRING(port, vendor_revision, vendor_revision);
 
-            SET_STRING(port, vendor_revision, vendor_revision);
+    pm_id_string(vendor_serial_number, fields.serial_number,
+                 PM_VENDOR_SN_LEN);
+    SET_INLINE_STRING(port, vendor_serial_number, vendor_serial_number);
 
-            // vendor_serial_number
-            memcpy(vendor_serial_number, qsfpp_serial_id->vendor_serial_number, PM_VENDOR_SN_LEN);
-            vendor_serial_number[PM_VENDOR_SN_LEN] = 0;
-            //带走尾随空格
-            idx = PM_VENDOR_SN_LEN - 1;
-            while (idx > 0 && SPACE == vendor_serial_number[idx]) {
-                vendor_serial_number[idx] = 0;
-                idx--;
-            }
+    // a0
+    SET_BINARY(port, a0, (char *)port->serial_id, fields.size);
 
-            SET_STRING(port, vendor_serial_number, vendor_serial_number);
+    // none of these columns is published to the database, so decoding
+    // them does not call for an update
+    port->module_info_changed = changed;
+}
 
-            // a0
-            SET_BINARY(port, a0, (char *) qsfpp_serial_id, sizeof(pm_qsfp_serial_id_t));
-            break;
-        default:
-            VLOG_WARN("port is unrecognized pluggable type: %s", port->instance);
-            break;
+//
+// pm_id_describe: vendor, part number and serial number of a serial ID
+//
+// input: buffer, connector of the port, serial ID page
+//
+// output: none
+//
+void
+pm_id_describe(struct ds *ds, const char *connector, const unsigned char *a0)
+{
+    pm_id_fields_t  fields;
+    char            vendor_name[PM_VENDOR_NAME_LEN+1];
+    char            vendor_part_number[PM_VENDOR_PN_LEN+1];
+    char            vendor_serial_number[PM_VENDOR_SN_LEN+1];
+    int             type = pm_module_type(connector);
+
+    if (type < 0) {
+        ds_put_cstr(ds, "-");
+        return;
     }
 
-    return 0;
-} // pm_parse
+    pm_id_fields(type, (const pm_sfp_serial_id_t *)a0, &fields);
+    ds_put_format(ds, "%-16s %-16s %-16s",
+                  pm_id_string(vendor_name, fields.name, PM_VENDOR_NAME_LEN),
+                  pm_id_string(vendor_part_number, fields.part_number,
+                               PM_VENDOR_PN_LEN),
+                  pm_id_string(vendor_serial_number, fields.serial_number,
+                               PM_VENDOR_SN_LEN));
+}
+
+// Check code regions of a serial ID. SFP+ and QSFP IDs share the layout
+// of theirs, a base (CC_BASE) and an extended (CC_EXT) region; a CMIS ID
+// has a single one.
+static const pm_id_region_t pm_id_sfp_regions[] = {
+    { 0, offsetof(pm_sfp_serial_id_t, check_code_for_base) + 1 },
+    { 64, offsetof(pm_sfp_serial_id_t, check_code_for_extended) + 1 - 64 },
+};
+
+static const pm_id_region_t pm_id_cmis_regions[] = {
+    { 0, offsetof(pm_cmis_serial_id_t, checksum) + 1 },
+};
+
+BUILD_ASSERT_DECL(offsetof(pm_sfp_serial_id_t, check_code_for_base) == 63);
+BUILD_ASSERT_DECL(offsetof(pm_sfp_serial_id_t, check_code_for_extended) ==
+                  95);
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_serial_id_t, check_code_for_base) ==
+                  offsetof(pm_sfp_serial_id_t, check_code_for_base));
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_serial_id_t, check_code_for_extended) ==
+                  offsetof(pm_sfp_serial_id_t, check_code_for_extended));
+BUILD_ASSERT_DECL(offsetof(pm_cmis_serial_id_t, checksum) == 222 - 128);
 
 //
-// pm_byte_sum：计算从头到尾的字节总数（含）
-//并与偏移量的字节进行比较
+// pm_id_regions: the check code regions of a port's serial ID
 //
-static int
-pm_byte_sum(unsigned char *block, int start, int end, int offset)
+// input: connector of the port, as in the hw description, pointer to set
+//        to the regions
+//
+// output: number of regions, 0 for an unknown connector
+//
+size_t
+pm_id_regions(const char *connector, const pm_id_region_t **regions)
 {
-    unsigned char value = 0;
-    int idx;
-
-    for (idx = start; idx <= end; idx++) {
-        value += block[idx];
-    }
-
-    if (value != block[offset]) {
-        return 1;
+    switch (pm_module_type(connector)) {
+    case MODULE_TYPE_SFP_PLUS:
+    case MODULE_TYPE_QSFP_PLUS:
+    case MODULE_TYPE_QSFP28:
+        *regions = pm_id_sfp_regions;
+        return ARRAY_SIZE(pm_id_sfp_regions);
+    case MODULE_TYPE_QSFP_DD:
+    case MODULE_TYPE_OSFP:
+        *regions = pm_id_cmis_regions;
+        return ARRAY_SIZE(pm_id_cmis_regions);
+    default:
+        *regions = NULL;
+        return 0;
     }
-
-    return 0;
 }
 
 //
-// sfpp_sum_verify：验证校验和值（适用于SFP +和QSFP）
+// pm_id_region_valid: whether the bytes of a region sum to its check code
 //
-int
-sfpp_sum_verify(unsigned char *serial_datap)
+// input: region, serial ID
+//
+// output: true if they do
+//
+bool
+pm_id_region_valid(const pm_id_region_t *region, const unsigned char *a0)
 {
-    int check;
-    // verify CC_BASE
-    check = pm_byte_sum(serial_datap, 0, 62, 63);
+    const unsigned char *block = a0 + region->offset;
+    unsigned char       value = 0;
+    size_t              idx;
 
-    // verify CC_EXT
-    check += pm_byte_sum(serial_datap, 64, 94, 95);
+    for (idx = 0; idx + 1 < region->len; idx++) {
+        value += block[idx];
+    }
 
-    return check;
+    return value == block[region->len - 1];
 }
@@ -28,41 +28,962 @@
 #include <stdarg.h>
 #include <ctype.h>
 #include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
 
 #include <vswitch-idl.h>
 #include <openswitch-idl.h>
+#include <hash.h>
+#include <random.h>
+#include <timeval.h>
+#include <util.h>
 
 #include "pmd.h"
 #include "plug.h"
 #include "pm_dom.h"
+#include "pm_cmis.h"
 
 VLOG_DEFINE_THIS_MODULE(dom);
 
+extern struct shash ovs_intfs;
+
+// number of samples kept in each port's DOM history
+size_t pm_dom_history_size = PM_DOM_HISTORY_DEFAULT_SIZE;
+unsigned int pm_dom_jitter = 0;
+
+//
+// pm_dom_history_init: allocate the DOM history ring for a port. This is
+//                      the only allocation, samples are recorded in place.
+//
+// input: port structure
+//
+// output: none
+//
+void
+pm_dom_history_init(pm_port_t *port)
+{
+    pm_dom_history_t *history = &port->dom_history;
+
+    history->samples = xcalloc(pm_dom_history_size, sizeof(pm_dom_sample_t));
+    history->size = pm_dom_history_size;
+    history->head = 0;
+    history->count = 0;
+}
+
+//
+// pm_dom_history_destroy: release the DOM history ring for a port
+//
+// input: port structure
+//
+// output: none
+//
+void
+pm_dom_history_destroy(pm_port_t *port)
+{
+    free(port->dom_history.samples);
+    memset(&port->dom_history, 0, sizeof(port->dom_history));
+}
+
+//
+// pm_dom_history_clear: forget all samples, e.g. after a module change
+//
+static void
+pm_dom_history_clear(pm_port_t *port)
+{
+    port->dom_history.head = 0;
+    port->dom_history.count = 0;
+}
+
+//
+// pm_dom_history_record: copy a sample into the next slot of the ring,
+//                        overwriting the oldest sample when full
+//
+static void
+pm_dom_history_record(pm_port_t *port, const pm_dom_sample_t *sample)
+{
+    pm_dom_history_t *history = &port->dom_history;
+
+    if (0 == history->size) {
+        return;
+    }
+
+    history->samples[history->head] = *sample;
+    history->head = (history->head + 1) % history->size;
+
+    if (history->count < history->size) {
+        history->count++;
+    }
+}
+
+//
+// DOM aggregates. Each sample updates min/max/sum/EWMA of every window in
+// place; nothing is formatted or published until a window closes.
+//
+static const struct pm_dom_window_def {
+    const char      *name;
+    long long int   length;             // msecs
+} pm_dom_windows[PM_DOM_N_WINDOWS] = {
+    [PM_DOM_WINDOW_1M]  = { "1m",  60 * 1000 },
+    [PM_DOM_WINDOW_15M] = { "15m", 15 * 60 * 1000 },
+};
+
+//
+// pm_dom_stats_init: prepare the aggregates of a port
+//
+void
+pm_dom_stats_init(pm_port_t *port)
+{
+    memset(port->dom_stats.windows, 0, sizeof(port->dom_stats.windows));
+    smap_init(&port->dom_stats.published);
+}
+
+//
+// pm_dom_stats_destroy: release the aggregates of a port
+//
+void
+pm_dom_stats_destroy(pm_port_t *port)
+{
+    smap_destroy(&port->dom_stats.published);
+}
+
+//
+// pm_dom_stats_clear: drop aggregates and published values, e.g. when the
+//                     module is removed or replaced
+//
+void
+pm_dom_stats_clear(pm_port_t *port)
+{
+    memset(port->dom_stats.windows, 0, sizeof(port->dom_stats.windows));
+
+    if (0 != smap_count(&port->dom_stats.published)) {
+        smap_clear(&port->dom_stats.published);
+        port->module_info_changed = true;
+    }
+}
+
+// the DOM columns are all strings, cleared as an array
+BUILD_ASSERT_DECL(sizeof(struct ovs_module_dom_info) % sizeof(char *) == 0);
+
+//
+// pm_dom_columns_clear: drop the readings, flags and thresholds of a
+//                       module that was removed or replaced
+//
+void
+pm_dom_columns_clear(pm_port_t *port)
+{
+    char    **columns = (char **)&port->ovs_module_dom_columns;
+    size_t  idx;
+
+    for (idx = 0; idx < sizeof(struct ovs_module_dom_info) / sizeof(char *);
+         idx++) {
+        if (NULL != columns[idx]) {
+            free(columns[idx]);
+            columns[idx] = NULL;
+            port->module_info_changed = true;
+        }
+    }
+}
+
+//
+// pm_dom_agg_add: fold one raw value into an aggregate. The EWMA uses a
+//                 weight of dt / window length (capped at 1), so it has
+//                 the same time constant whatever the polling interval.
+//
+static void
+pm_dom_agg_add(pm_dom_agg_t *agg, int32_t raw, long long int dt,
+               long long int length)
+{
+    int64_t scaled = (int64_t)raw * (1 << PM_DOM_EWMA_FRACTION_BITS);
+
+    if (0 == agg->count) {
+        agg->min = raw;
+        agg->max = raw;
+    } else if (raw < agg->min) {
+        agg->min = raw;
+    } else if (raw > agg->max) {
+        agg->max = raw;
+    }
+    agg->sum += raw;
+    agg->count++;
+
+    if (false == agg->ewma_valid || dt >= length) {
+        agg->ewma = scaled;
+        agg->ewma_valid = true;
+    } else if (dt > 0) {
+        agg->ewma += ((scaled - agg->ewma) * dt) / length;
+    }
+}
+
+//
+// pm_dom_agg_reset: start a new window, keeping the EWMA
+//
+static void
+pm_dom_agg_reset(pm_dom_agg_t *agg)
+{
+    agg->min = 0;
+    agg->max = 0;
+    agg->sum = 0;
+    agg->count = 0;
+}
+
+static void
+pm_dom_publish(struct smap *published, const char *quantity,
+               const char *window, const char *stat, double value,
+               int precision)
+{
+    char key[64];
+    char buf[32];
+
+    snprintf(key, sizeof(key), "%s_%s_%s", quantity, window, stat);
+    snprintf(buf, sizeof(buf), "%.*f", precision, value);
+    smap_replace(published, key, buf);
+}
+
+static void
+pm_dom_agg_publish(struct smap *published, const char *quantity,
+                   const char *window, const pm_dom_agg_t *agg, double unit,
+                   int precision)
+{
+    if (0 == agg->count) {
+        return;
+    }
+
+    pm_dom_publish(published, quantity, window, "min",
+                   agg->min * unit, precision);
+    pm_dom_publish(published, quantity, window, "max",
+                   agg->max * unit, precision);
+    pm_dom_publish(published, quantity, window, "mean",
+                   (double)agg->sum / agg->count * unit, precision);
+    pm_dom_publish(published, quantity, window, "ewma",
+                   (double)agg->ewma / (1 << PM_DOM_EWMA_FRACTION_BITS) * unit,
+                   precision);
+}
+
+//
+// pm_dom_window_close: publish the aggregates of a window that has ended
+//                      and start the next one. EWMAs carry over.
+//
+static void
+pm_dom_window_close(pm_port_t *port, size_t w, bool sfp,
+                    const pm_dom_sample_t *sample)
+{
+    pm_dom_window_t *window = &port->dom_stats.windows[w];
+    struct smap     *published = &port->dom_stats.published;
+    const char      *name = pm_dom_windows[w].name;
+    char            quantity[16];
+    int             lane;
+
+    pm_dom_agg_publish(published, "temperature", name, &window->temperature,
+                       PM_DOM_TEMPERATURE_UNIT, 2);
+
+    for (lane = 0; lane < sample->n_lanes; lane++) {
+        // SFPs use the unnumbered column names, QSFPs number the lanes.
+        // Not every QSFP measures tx power.
+        if (sfp) {
+            pm_dom_agg_publish(published, "tx_power", name,
+                               &window->tx_power[lane],
+                               PM_DOM_POWER_UNIT, 4);
+            snprintf(quantity, sizeof(quantity), "rx_power");
+        } else {
+            if (sample->has_tx_power) {
+                snprintf(quantity, sizeof(quantity), "tx%d_power", lane + 1);
+                pm_dom_agg_publish(published, quantity, name,
+                                   &window->tx_power[lane],
+                                   PM_DOM_POWER_UNIT, 4);
+            }
+            snprintf(quantity, sizeof(quantity), "rx%d_power", lane + 1);
+        }
+        pm_dom_agg_publish(published, quantity, name,
+                           &window->rx_power[lane],
+                           PM_DOM_POWER_UNIT, 4);
+    }
+
+    port->module_info_changed = true;
+
+    pm_dom_agg_reset(&window->temperature);
+    for (lane = 0; lane < PM_DOM_MAX_LANES; lane++) {
+        pm_dom_agg_reset(&window->tx_power[lane]);
+        pm_dom_agg_reset(&window->rx_power[lane]);
+    }
+}
+
+//
+// pm_dom_stats_update: fold a sample into every window, publishing any
+//                      window whose bin the sample has moved past
+//
+// input: port structure, sample
+//
+// output: none
+//
+static void
+pm_dom_stats_update(pm_port_t *port, const pm_dom_sample_t *sample)
+{
+    bool    sfp;
+    size_t  w;
+    int     lane;
+
+    sfp = (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS));
+
+    for (w = 0; w < PM_DOM_N_WINDOWS; w++) {
+        pm_dom_window_t *window = &port->dom_stats.windows[w];
+        long long int   length = pm_dom_windows[w].length;
+        long long int   bin = sample->time / length;
+        long long int   dt = sample->time - window->last_time;
+
+        if (bin != window->bin) {
+            if (0 != window->temperature.count) {
+                pm_dom_window_close(port, w, sfp, sample);
+            }
+            window->bin = bin;
+        }
+        window->last_time = sample->time;
+
+        pm_dom_agg_add(&window->temperature, sample->temperature, dt, length);
+        for (lane = 0; lane < sample->n_lanes; lane++) {
+            if (sample->has_tx_power) {
+                pm_dom_agg_add(&window->tx_power[lane],
+                               sample->tx_power[lane], dt, length);
+            }
+            pm_dom_agg_add(&window->rx_power[lane],
+                           sample->rx_power[lane], dt, length);
+        }
+    }
+}
+
+static void
+pm_dom_sample_format(struct ds *ds, const pm_dom_sample_t *sample)
+{
+    struct tm   tm;
+    time_t      secs;
+    char        stamp[32];
+    int         lane;
+
+    secs = sample->time / 1000;
+    gmtime_r(&secs, &tm);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+
+    ds_put_format(ds, "    %s.%03lld temperature=%.2fC vcc=%.4fV\n",
+                  stamp, sample->time % 1000,
+                  sample->temperature * PM_DOM_TEMPERATURE_UNIT,
+                  sample->vcc * PM_DOM_VCC_UNIT);
+
+    for (lane = 0; lane < sample->n_lanes; lane++) {
+        ds_put_format(ds, "        lane %d: tx_bias=%.3fmA", lane + 1,
+                      sample->tx_bias[lane] * PM_DOM_BIAS_UNIT);
+        if (sample->has_tx_power) {
+            ds_put_format(ds, " tx_power=%.4fmW",
+                          sample->tx_power[lane] * PM_DOM_POWER_UNIT);
+        }
+        ds_put_format(ds, " rx_power=%.4fmW\n",
+                      sample->rx_power[lane] * PM_DOM_POWER_UNIT);
+    }
+}
+
+//
+// pm_dom_history_dump: format the last n samples (all if n is 0) of an
+//                      interface, oldest first
+//
+// input: dynamic string, interface name, sample count
+//
+// output: 0 on success, -1 if the interface is unknown
+//
+int
+pm_dom_history_dump(struct ds *ds, const char *name, size_t n)
+{
+    struct shash_node   *node;
+    pm_port_t           *port;
+    pm_dom_history_t    *history;
+    size_t              start;
+    size_t              idx;
+
+    node = shash_find(&ovs_intfs, name);
+    if (NULL == node) {
+        ds_put_cstr(ds, "No such interface");
+        return -1;
+    }
+    port = (pm_port_t *)node->data;
+    history = &port->dom_history;
+
+    if (0 == n || n > history->count) {
+        n = history->count;
+    }
+
+    ds_put_format(ds, "DOM history for Interface %s (%zu of %zu samples):\n",
+                  port->instance, n, history->size);
+
+    if (0 == n) {
+        return 0;
+    }
+
+    start = (history->head + history->size - n) % history->size;
+    for (idx = 0; idx < n; idx++) {
+        pm_dom_sample_format(ds,
+                             &history->samples[(start + idx) % history->size]);
+    }
+
+    return 0;
+}
+
+//
+// DOM polling schedule. Slowly changing quantities are polled less often
+// than fast ones; each entry gives the byte range of the quantity in the
+// SFP A2h page, in the QSFP lower page and in a CMIS page (0 for the
+// lower page). A length of 0 means the module type does not report the
+// quantity; QSFPs only report tx power if they advertise it.
+//
+#define PM_DOM_SECONDS(secs)    ((secs) * 1000)
+
+// Ranges closer than this are read in a single transaction
+#define PM_DOM_MERGE_GAP        4
+
+static const struct pm_dom_range {
+    const char      *name;
+    unsigned int    interval;           // msecs
+    size_t          sfp_offset;
+    size_t          sfp_len;
+    size_t          qsfp_offset;
+    size_t          qsfp_len;
+    uint8_t         cmis_page;
+    size_t          cmis_offset;
+    size_t          cmis_len;
+} pm_dom_ranges[PM_DOM_N_QUANTITIES] = {
+    [PM_DOM_Q_TEMPERATURE] = {
+        "temperature", PM_DOM_SECONDS(30),
+        offsetof(pm_sfp_dom_t, temperature_msb), 2,
+        offsetof(pm_qsfp_dom_t, module_monitors.temp_msb), 2,
+        0, PM_CMIS_TEMPERATURE, 2,
+    },
+    [PM_DOM_Q_VCC] = {
+        "vcc", PM_DOM_SECONDS(30),
+        offsetof(pm_sfp_dom_t, vcc_msb), 2,
+        offsetof(pm_qsfp_dom_t, module_monitors.voltage_msb), 2,
+        0, PM_CMIS_VCC, 2,
+    },
+    [PM_DOM_Q_TX_BIAS] = {
+        "tx_bias", PM_DOM_SECONDS(5),
+        offsetof(pm_sfp_dom_t, tx_bias_msb), 2,
+        offsetof(pm_qsfp_dom_t, channel_monitors.tx1_bias_msb), 8,
+        PM_CMIS_LANE_STATUS, PM_CMIS_TX_BIAS, PM_CMIS_LANE_MONITOR_LEN,
+    },
+    [PM_DOM_Q_TX_POWER] = {
+        "tx_power", PM_DOM_SECONDS(5),
+        offsetof(pm_sfp_dom_t, tx_power_msb), 2,
+        offsetof(pm_qsfp_dom_t, channel_monitors.tx1_power_msb), 8,
+        PM_CMIS_LANE_STATUS, PM_CMIS_TX_POWER, PM_CMIS_LANE_MONITOR_LEN,
+    },
+    [PM_DOM_Q_RX_POWER] = {
+        "rx_power", PM_DOM_SECONDS(1),
+        offsetof(pm_sfp_dom_t, rx_power_msb), 2,
+        offsetof(pm_qsfp_dom_t, channel_monitors.rx1_power_msb), 8,
+        PM_CMIS_LANE_STATUS, PM_CMIS_RX_POWER, PM_CMIS_LANE_MONITOR_LEN,
+    },
+    [PM_DOM_Q_FLAGS] = {
+        "flags", PM_DOM_SECONDS(1),
+        offsetof(pm_sfp_dom_t, status_control_bits),
+        sizeof(pm_sfp_status_control_bits_t) +
+            sizeof(pm_sfp_alarm_warning_bits_t),
+        offsetof(pm_qsfp_dom_t, interrupt_flags),
+        sizeof(pm_qsfp_interrupt_flags_t),
+        0, PM_CMIS_MODULE_FLAGS, 2,
+    },
+};
+
+BUILD_ASSERT_DECL(PM_CMIS_N_PAGES <= PM_DOM_MAX_PAGE_READS);
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_dom_t, channel_monitors.tx1_power_msb) ==
+                  50);
+
+//
+// pm_dom_has_tx_power: whether a module measures tx output power. SFPs
+//                      and CMIS modules always do, QSFPs advertise it in
+//                      byte 220 of upper page 00h.
+//
+static bool
+pm_dom_has_tx_power(const pm_port_t *port, bool sfp)
+{
+    return sfp || NULL != port->cmis ||
+           PM_SFF_TEST(port->serial_id, PM_QSFP_DIAG_TX_POWER);
+}
+
+//
+// pm_dom_reset: forget the DOM page and make every quantity due, so the
+//               next poll reads the whole page (including thresholds)
+//
+static void
+pm_dom_reset(pm_port_t *port)
+{
+    memset(&port->dom, 0, sizeof(port->dom));
+    pm_cmis_reset(port);
+}
+
+// page a read is in: 0 for the lower page, bank and page + 1 otherwise
+static unsigned int
+pm_dom_read_page(const pm_dom_read_t *read)
+{
+    if (read->offset < PM_DOM_PAGE_SIZE) {
+        return 0;
+    }
+
+    return ((read->bank << 8) | read->page) + 1;
+}
+
+// reads of the lower page go first, then those of each upper page
+static int
+pm_dom_read_compare(const void *a_, const void *b_)
+{
+    const pm_dom_read_t *a = a_;
+    const pm_dom_read_t *b = b_;
+    unsigned int a_page = pm_dom_read_page(a);
+    unsigned int b_page = pm_dom_read_page(b);
+
+    if (a_page != b_page) {
+        return (a_page > b_page) - (a_page < b_page);
+    }
+
+    return (a->offset > b->offset) - (a->offset < b->offset);
+}
+
+//
+// pm_dom_slot: first time at or after 'now' that falls on this port's
+//              phase for a polling interval. The phase is derived from the
+//              interface name, so ports are spread evenly across the
+//              interval and keep the same slots from one run to the next.
+//
+// input: port structure, quantity (PM_DOM_N_QUANTITIES for the full read),
+//        polling interval, current monotonic time in msecs
+//
+// output: due time in msecs
+//
+static long long int
+pm_dom_slot(const pm_port_t *port, size_t quantity, unsigned int interval,
+            long long int now)
+{
+    long long int phase;
+
+    phase = hash_string(port->instance, quantity) % interval;
+
+    return now + (phase - now % interval + interval) % interval;
+}
+
+//
+// pm_dom_reschedule: move a quantity to its next slot. Stepping by whole
+//                    intervals keeps the port's phase; slots missed while
+//                    the daemon was busy are skipped rather than replayed.
+//
+static void
+pm_dom_reschedule(pm_port_t *port, size_t quantity, long long int now)
+{
+    pm_dom_state_t  *dom = &port->dom;
+    unsigned int    interval = pm_dom_ranges[quantity].interval;
+    unsigned int    jitter = MIN(pm_dom_jitter, interval / 2);
+
+    dom->next_due[quantity] += interval;
+    if (dom->next_due[quantity] <= now) {
+        dom->next_due[quantity] = pm_dom_slot(port, quantity, interval,
+                                              now + 1);
+    }
+
+    dom->jitter[quantity] = jitter ? random_range(jitter + 1) : 0;
+}
+
+//
+// pm_dom_plan: work out which parts of the DOM page are due to be read.
+//              Due quantities are rescheduled and adjacent byte ranges are
+//              merged, so each returned range is one read transaction.
+//              The ranges come ordered by page, lower page first, so CMIS
+//              modules select each upper page once per poll.
+//
+// input: port structure, current monotonic time in msecs, output array
+//        with room for PM_DOM_MAX_READS ranges
+//
+// output: number of ranges to read (0 if nothing is due)
+//
+size_t
+pm_dom_plan(pm_port_t *port, long long int now, pm_dom_read_t reads[])
+{
+    const struct pm_dom_range *range;
+    pm_dom_state_t  *dom = &port->dom;
+    bool            sfp;
+    bool            cmis = (NULL != port->cmis);
+    size_t          count = 0;
+    size_t          merged;
+    size_t          idx;
+
+    sfp = (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS));
+
+    // the first poll after insertion reads the whole page, which also
+    // picks up the alarm and warning thresholds, and the upper pages of
+    // a CMIS module. It waits for the port's slot in the fastest interval,
+    // so modules found together at startup are not all read in the same
+    // sweep, and if it fails it is tried again in the next slot.
+    if (false == dom->valid) {
+        unsigned int interval = pm_dom_ranges[PM_DOM_Q_RX_POWER].interval;
+
+        if (false == dom->scheduled) {
+            dom->full_due = pm_dom_slot(port, PM_DOM_N_QUANTITIES, interval,
+                                        now);
+            dom->scheduled = true;
+        }
+        if (dom->full_due > now) {
+            return 0;
+        }
+        dom->full_due = pm_dom_slot(port, PM_DOM_N_QUANTITIES, interval,
+                                    now + 1);
+
+        reads[count++] = (pm_dom_read_t) {
+            .offset = 0,
+            .len = PM_DOM_PAGE_SIZE,
+        };
+        if (cmis) {
+            count += pm_cmis_plan_pages(port, now, &reads[count]);
+        }
+
+        for (idx = 0; idx < PM_DOM_N_QUANTITIES; idx++) {
+            dom->next_due[idx] = pm_dom_slot(port, idx,
+                                             pm_dom_ranges[idx].interval,
+                                             now + 1);
+            dom->jitter[idx] = 0;
+        }
+        return count;
+    }
+
+    // upper pages still missing, on their own retry schedule, along with
+    // the quantities that are due
+    if (cmis) {
+        count += pm_cmis_plan_pages(port, now, &reads[count]);
+    }
+
+    for (idx = 0; idx < PM_DOM_N_QUANTITIES; idx++) {
+        range = &pm_dom_ranges[idx];
+
+        if (dom->next_due[idx] + dom->jitter[idx] > now) {
+            continue;
+        }
+        pm_dom_reschedule(port, idx, now);
+
+        if (cmis) {
+            // lane monitors are only polled if the module has them
+            if (0 != range->cmis_len &&
+                (0 == range->cmis_page || pm_cmis_lanes_monitored(port))) {
+                reads[count++] = (pm_dom_read_t) {
+                    .offset = range->cmis_offset,
+                    .len = range->cmis_len,
+                    .page = range->cmis_page,
+                };
+            }
+        } else if (sfp && 0 != range->sfp_len) {
+            reads[count++] = (pm_dom_read_t) {
+                .offset = range->sfp_offset,
+                .len = range->sfp_len,
+            };
+        } else if (!sfp && 0 != range->qsfp_len &&
+                   (PM_DOM_Q_TX_POWER != idx ||
+                    pm_dom_has_tx_power(port, sfp))) {
+            reads[count++] = (pm_dom_read_t) {
+                .offset = range->qsfp_offset,
+                .len = range->qsfp_len,
+            };
+        }
+    }
+
+    if (count < 2) {
+        return count;
+    }
+
+    qsort(reads, count, sizeof(pm_dom_read_t), pm_dom_read_compare);
+
+    merged = 0;
+    for (idx = 1; idx < count; idx++) {
+        pm_dom_read_t *last = &reads[merged];
+        size_t end = last->offset + last->len;
+
+        if (pm_dom_read_page(&reads[idx]) == pm_dom_read_page(last) &&
+            reads[idx].offset <= end + PM_DOM_MERGE_GAP) {
+            size_t new_end = reads[idx].offset + reads[idx].len;
+
+            if (new_end > end) {
+                last->len = new_end - last->offset;
+            }
+        } else {
+            reads[++merged] = reads[idx];
+        }
+    }
+
+    return merged + 1;
+}
+
+//
+// External calibration (SFF-8472 section 9.3). The constants are decoded
+// into floats once, when the page is first read in full; each sample then
+// costs one multiply-add per value plus four for the Rx power polynomial.
+//
+
+// slope: unsigned fixed point, integer part in the first byte
+static float
+pm_dom_cal_slope(const unsigned char *bytes)
+{
+    return (float)PM_DOM_RAW16(bytes[0], bytes[1]) / 256;
+}
+
+// offset: signed 16-bit, in the units of the calibrated value
+static float
+pm_dom_cal_offset(const unsigned char *bytes)
+{
+    return (float)(int16_t)PM_DOM_RAW16(bytes[0], bytes[1]);
+}
+
+// IEEE 754 single precision, most significant byte first
+static float
+pm_dom_cal_float(const unsigned char *bytes)
+{
+    uint32_t    word;
+    float       value;
+
+    word = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+           ((uint32_t)bytes[2] << 8) | bytes[3];
+    memcpy(&value, &word, sizeof(value));
+
+    return value;
+}
+
+// round a calibrated value into the range of its 16-bit field
+static long
+pm_dom_cal_round(float value, long min, long max)
+{
+    long rounded = lrintf(value);
+
+    return rounded < min ? min : (rounded > max ? max : rounded);
+}
+
+static void
+pm_dom_cal_put(unsigned char *msb, long value)
+{
+    msb[0] = (value >> 8) & 0xff;
+    msb[1] = value & 0xff;
+}
+
+// linear conversion of an unsigned value in place
+static void
+pm_dom_cal_linear(unsigned char *msb, float slope, float offset)
+{
+    float value = fmaf(slope, PM_DOM_RAW16(msb[0], msb[1]), offset);
+
+    pm_dom_cal_put(msb, pm_dom_cal_round(value, 0, UINT16_MAX));
+}
+
+// temperature is signed
+static void
+pm_dom_cal_temperature(unsigned char *msb, const pm_dom_calibration_t *cal)
+{
+    float value = fmaf(cal->t_slope, (int16_t)PM_DOM_RAW16(msb[0], msb[1]),
+                       cal->t_offset);
+
+    pm_dom_cal_put(msb, pm_dom_cal_round(value, INT16_MIN, INT16_MAX));
+}
+
+// Rx power is a fourth order polynomial of the raw value, in Horner form
+static void
+pm_dom_cal_rx_power(unsigned char *msb, const pm_dom_calibration_t *cal)
+{
+    float raw = PM_DOM_RAW16(msb[0], msb[1]);
+    float value;
+
+    value = fmaf(cal->rx_pwr[4], raw, cal->rx_pwr[3]);
+    value = fmaf(value, raw, cal->rx_pwr[2]);
+    value = fmaf(value, raw, cal->rx_pwr[1]);
+    value = fmaf(value, raw, cal->rx_pwr[0]);
+
+    pm_dom_cal_put(msb, pm_dom_cal_round(value, 0, UINT16_MAX));
+}
+
+//
+// pm_dom_cal_load: decode the calibration constants of a freshly read
+//                  page and calibrate its thresholds, which do not change
+//                  while the module stays inserted
+//
+static void
+pm_dom_cal_load(pm_port_t *port, const pm_sfp_dom_t *a2_data)
+{
+    pm_dom_calibration_t *cal = &port->dom.cal;
+    unsigned char   *thresholds = cal->thresholds;
+    int             idx;
+
+    cal->rx_pwr[4] = pm_dom_cal_float(a2_data->rx_pwr4);
+    cal->rx_pwr[3] = pm_dom_cal_float(a2_data->rx_pwr3);
+    cal->rx_pwr[2] = pm_dom_cal_float(a2_data->rx_pwr2);
+    cal->rx_pwr[1] = pm_dom_cal_float(a2_data->rx_pwr1);
+    cal->rx_pwr[0] = pm_dom_cal_float(a2_data->rx_pwr0);
+    cal->tx_i_slope = pm_dom_cal_slope(a2_data->current_tx_slope);
+    cal->tx_i_offset = pm_dom_cal_offset(a2_data->current_tx_offset);
+    cal->tx_pwr_slope = pm_dom_cal_slope(a2_data->power_tx_slope);
+    cal->tx_pwr_offset = pm_dom_cal_offset(a2_data->power_tx_offset);
+    cal->t_slope = pm_dom_cal_slope(a2_data->temperature_slope);
+    cal->t_offset = pm_dom_cal_offset(a2_data->temperature_offset);
+    cal->v_slope = pm_dom_cal_slope(a2_data->voltage_slope);
+    cal->v_offset = pm_dom_cal_offset(a2_data->voltage_offset);
+
+    // thresholds come as high alarm, low alarm, high warning, low warning
+    // for temperature, vcc, bias, tx power and rx power in turn
+    memcpy(thresholds, a2_data, sizeof(cal->thresholds));
+    for (idx = 0; idx < 4; idx++) {
+        pm_dom_cal_temperature(thresholds + 0 + 2 * idx, cal);
+        pm_dom_cal_linear(thresholds + 8 + 2 * idx,
+                          cal->v_slope, cal->v_offset);
+        pm_dom_cal_linear(thresholds + 16 + 2 * idx,
+                          cal->tx_i_slope, cal->tx_i_offset);
+        pm_dom_cal_linear(thresholds + 24 + 2 * idx,
+                          cal->tx_pwr_slope, cal->tx_pwr_offset);
+        pm_dom_cal_rx_power(thresholds + 32 + 2 * idx, cal);
+    }
+
+    cal->loaded = true;
+    VLOG_DBG("loaded external calibration for %s", port->instance);
+}
+
+//
+// pm_dom_calibrate: produce an internally calibrated copy of an SFP page
+//
+// input: port structure, raw page, output page
+//
+// output: none
+//
+static void
+pm_dom_calibrate(pm_port_t *port, const pm_sfp_dom_t *a2_data,
+                 pm_sfp_dom_t *calibrated)
+{
+    const pm_dom_calibration_t *cal = &port->dom.cal;
+
+    if (false == cal->loaded) {
+        pm_dom_cal_load(port, a2_data);
+    }
+
+    memcpy(calibrated, a2_data, sizeof(*calibrated));
+    memcpy(calibrated, cal->thresholds, sizeof(cal->thresholds));
+
+    pm_dom_cal_temperature((unsigned char *)&calibrated->temperature_msb, cal);
+    pm_dom_cal_linear(&calibrated->vcc_msb, cal->v_slope, cal->v_offset);
+    pm_dom_cal_linear(&calibrated->tx_bias_msb,
+                      cal->tx_i_slope, cal->tx_i_offset);
+    pm_dom_cal_linear(&calibrated->tx_power_msb,
+                      cal->tx_pwr_slope, cal->tx_pwr_offset);
+    pm_dom_cal_rx_power(&calibrated->rx_power_msb, cal);
+}
+
 /*
   * set_a2_read_request：如果DOM信息存在且集成，则设置a2_read_requested
   */
 void
 set_a2_read_request(pm_port_t *port, pm_sfp_serial_id_t *serial_datap)
 {
+    bool capable = false;
+    bool external = false;
+
     if (0 == strcmp(port->module_device->connector, CONNECTOR_SFP_PLUS)) {
-        if (serial_datap->diag_monitor_type.implemented_digital &&
-                serial_datap->diag_monitor_type.internally_calibrated &&
-                serial_datap->diag_monitor_type.power_measurement_type &&
-                !serial_datap->diag_monitor_type.addr_change_required) {
-            port->a2_read_requested = true;
-            VLOG_DBG("sfpp serial id data indicates that the DOM info is present");
+        if (PM_SFF_TEST(serial_datap, PM_SFP_DIAG_IMPLEMENTED) &&
+                (PM_SFF_TEST(serial_datap, PM_SFP_DIAG_INTERNAL) ||
+                 PM_SFF_TEST(serial_datap, PM_SFP_DIAG_EXTERNAL)) &&
+                PM_SFF_TEST(serial_datap, PM_SFP_DIAG_AVERAGE_POWER) &&
+                !PM_SFF_TEST(serial_datap, PM_SFP_DIAG_ADDR_CHANGE)) {
+            capable = true;
+            external = !PM_SFF_TEST(serial_datap, PM_SFP_DIAG_INTERNAL);
+            VLOG_DBG("sfpp serial id data indicates that the DOM info is present%s",
+                     external ? " (externally calibrated)" : "");
         }
     } else if ((0 == strcmp(port->module_device->connector,
                             CONNECTOR_QSFP_PLUS)) ||
                (0 == strcmp(port->module_device->connector,
                             CONNECTOR_QSFP28))) {
-        pm_qsfp_serial_id_t *qsfpp_serial_id;
+        if (PM_SFF_TEST(serial_datap, PM_QSFP_DIAG_AVERAGE_POWER)) {
+            capable = true;
+            VLOG_DBG("qsfpp serial id data indicates that the DOM info is present");
+        }
+    } else if (NULL != port->cmis) {
+        // module monitors are mandatory; which lane monitors there are
+        // is advertised in page 01h, read with the first full poll
+        capable = true;
+    }
 
-        qsfpp_serial_id = (pm_qsfp_serial_id_t *)serial_datap;
+    pm_dom_set_capability(port, capable, external);
+}
 
-        if (qsfpp_serial_id->diag_monitor_type.average_input_optical_power) {
-            port->a2_read_requested = true;
-            VLOG_DBG("qsfpp serial id data indicates that the DOM info is present");
+//
+// pm_dom_set_capability: start DOM polling of a newly identified module
+//                        from scratch
+//
+// input: port structure, whether the module has DOM, whether its SFP DOM
+//        is externally calibrated
+//
+// output: none
+//
+void
+pm_dom_set_capability(pm_port_t *port, bool capable, bool external)
+{
+    //samples of a previous module are meaningless for the new one
+    pm_dom_history_clear(port);
+    pm_dom_stats_clear(port);
+    pm_dom_reset(port);
+    port->a2_read_requested = capable;
+    port->dom.cal.external = external;
+}
+
+// DOM flag columns of each module type
+static const pm_dom_flag_t pm_sfp_dom_flags[] = {
+    PM_SFP_DOM_FLAGS(PM_DOM_FLAG)
+};
+
+static const pm_dom_flag_t pm_qsfp_dom_flags[] = {
+    PM_QSFP_DOM_FLAGS(PM_DOM_FLAG)
+};
+
+#define PM_SFP_DOM_FLAG_IN_PAGE(column, offset, bit) \
+    BUILD_ASSERT_DECL(PM_SFF_IN(pm_sfp_dom_t, alarm_warning_bits, offset) && \
+                      (bit) < 8);
+#define PM_QSFP_DOM_FLAG_IN_PAGE(column, offset, bit) \
+    BUILD_ASSERT_DECL(PM_SFF_IN(pm_qsfp_dom_t, interrupt_flags, offset) && \
+                      (offset) >= PM_QSFP_DOM_FLAGS_OFFSET && \
+                      (offset) < PM_QSFP_DOM_FLAGS_OFFSET + \
+                                 PM_QSFP_DOM_FLAGS_LEN && \
+                      (bit) < 8);
+
+PM_SFP_DOM_FLAGS(PM_SFP_DOM_FLAG_IN_PAGE)
+PM_QSFP_DOM_FLAGS(PM_QSFP_DOM_FLAG_IN_PAGE)
+
+BUILD_ASSERT_DECL(offsetof(pm_sfp_dom_t, alarm_warning_bits) ==
+                  PM_SFP_DOM_FLAGS_OFFSET);
+BUILD_ASSERT_DECL(sizeof(pm_sfp_alarm_warning_bits_t) ==
+                  PM_SFP_DOM_FLAGS_LEN);
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_dom_t, interrupt_flags) == 3);
+BUILD_ASSERT_DECL(offsetof(pm_sfp_serial_id_t, diag_monitor_type) ==
+                  PM_SFP_ID_DIAG_MONITORING);
+BUILD_ASSERT_DECL(offsetof(pm_qsfp_serial_id_t, diag_monitor_type) ==
+                  PM_QSFP_ID_DIAG_MONITORING);
+
+//
+// pm_dom_set_flags: set flag columns from the bits of a DOM page, a byte
+//                   load and a mask each
+//
+// input: port structure, flag table, number of flags, DOM page
+//
+// output: none
+//
+void
+pm_dom_set_flags(pm_port_t *port, const pm_dom_flag_t flags[], size_t n,
+                 const unsigned char *page)
+{
+    char    *columns = (char *)&port->ovs_module_dom_columns;
+    char    **column;
+    const char *value;
+    size_t  idx;
+
+    for (idx = 0; idx < n; idx++) {
+        column = (char **)(columns + flags[idx].column);
+        value = PM_SFF_IS_SET(page, flags[idx].bit) ? "On" : "Off";
+
+        // as SET_BOOL_STRING
+        if (NULL == *column || 0 != strcmp(*column, value)) {
+            free(*column);
+            *column = xstrdup(value);
+            port->module_info_changed = true;
         }
     }
 }
@@ -88,6 +1009,9 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
           tx1_bias, tx2_bias, tx3_bias, tx4_bias,
           rx1_power, rx2_power, rx3_power, rx4_power;
     pm_qsfp_dom_t *qsfp_a2_data;
+    pm_dom_sample_t sample;
+    pm_sfp_dom_t calibrated;
+    int lane;
 
     //忽略不可插拔的模块
     if (false == port->module_device->pluggable) {
@@ -108,6 +1032,10 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
         type = MODULE_TYPE_QSFP_PLUS;
     } else if (strcmp(port->module_device->connector, CONNECTOR_QSFP28) == 0) {
         type = MODULE_TYPE_QSFP28;
+    } else if (strcmp(port->module_device->connector, CONNECTOR_QSFP_DD) == 0) {
+        type = MODULE_TYPE_QSFP_DD;
+    } else if (strcmp(port->module_device->connector, CONNECTOR_OSFP) == 0) {
+        type = MODULE_TYPE_OSFP;
     } else {
         VLOG_WARN("unknown connector type for port: %s (%s)",
                   port->instance, port->module_device->connector);
@@ -118,21 +1046,22 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
         return;
     }
 
+    //externally calibrated modules are converted up front, so everything
+    //below sees internally calibrated values
+    if (MODULE_TYPE_SFP_PLUS == type && port->dom.cal.external) {
+        pm_dom_calibrate(port, a2_data, &calibrated);
+        a2_data = &calibrated;
+    }
+
+    memset(&sample, 0, sizeof(sample));
+    sample.time = time_wall_msec();
+
     switch (type) {
         case MODULE_TYPE_SFP_PLUS:
           //解析温度值
             temperature = (a2_data->temperature_msb +
                           (float)(a2_data->temperature_lsb/256));
-            SET_FLOAT_STRING(port, temperature, temperature);
-
-            SET_BOOL_STRING(port, temperature_high_alarm,
-                            a2_data->alarm_warning_bits.temp_high_alarm);
-            SET_BOOL_STRING(port, temperature_low_alarm,
-                            a2_data->alarm_warning_bits.temp_low_alarm);
-            SET_BOOL_STRING(port, temperature_high_warning,
-                            a2_data->alarm_warning_bits.temp_high_warning);
-            SET_BOOL_STRING(port, temperature_low_warning,
-                            a2_data->alarm_warning_bits.temp_low_warning);
+            SET_READING_STRING(port, temperature, temperature);
 
             temp_high_alarm = (a2_data->temp_high_alarm_msb +
                               (float)(a2_data->temp_high_alarm_lsb/256));
@@ -158,16 +1087,7 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
             //解析Vcc值
             vcc = (float) ((a2_data->vcc_msb<<8) |
                   (a2_data->vcc_lsb)) * 0.0001;
-            SET_FLOAT_STRING(port, vcc, vcc);
-
-            SET_BOOL_STRING(port, vcc_high_alarm,
-                            a2_data->alarm_warning_bits.vcc_high_alarm);
-            SET_BOOL_STRING(port, vcc_low_alarm,
-                            a2_data->alarm_warning_bits.vcc_low_alarm);
-            SET_BOOL_STRING(port, vcc_high_warning,
-                            a2_data->alarm_warning_bits.vcc_high_warning);
-            SET_BOOL_STRING(port, vcc_low_warning,
-                            a2_data->alarm_warning_bits.vcc_low_warning);
+            SET_READING_STRING(port, vcc, vcc);
 
             voltage_high_alarm = (float) ((a2_data->voltage_high_alarm_msb<<8) |
                                  (a2_data->voltage_high_alarm_lsb)) * 0.0001;
@@ -189,16 +1109,7 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
 
             //解析tx_bias
             tx_bias = (float) (a2_data->tx_bias_msb<<8 | a2_data->tx_bias_lsb) * 0.002;
-            SET_FLOAT_STRING(port, tx_bias, tx_bias);
-
-            SET_BOOL_STRING(port, tx_bias_high_alarm,
-                            a2_data->alarm_warning_bits.tx_bias_high_alarm);
-            SET_BOOL_STRING(port, tx_bias_low_alarm,
-                            a2_data->alarm_warning_bits.tx_bias_low_alarm);
-            SET_BOOL_STRING(port, tx_bias_high_warning,
-                            a2_data->alarm_warning_bits.tx_bias_high_warning);
-            SET_BOOL_STRING(port, tx_bias_low_warning,
-                            a2_data->alarm_warning_bits.tx_bias_low_warning);
+            SET_READING_STRING(port, tx_bias, tx_bias);
 
             bias_high_alarm = (float) (a2_data->bias_high_alarm_msb<<8 |
                               a2_data->bias_high_alarm_lsb) * 0.002;
@@ -219,16 +1130,7 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
 
             //解析rx_power
             rx_power = (float) (a2_data->rx_power_msb<<8 | a2_data->rx_power_lsb) * 0.0001;
-            SET_FLOAT_STRING(port, rx_power, rx_power);
-
-            SET_BOOL_STRING(port, rx_power_high_alarm,
-                            a2_data->alarm_warning_bits.rx_pwr_high_alarm);
-            SET_BOOL_STRING(port, rx_power_low_alarm,
-                            a2_data->alarm_warning_bits.rx_pwr_low_alarm);
-            SET_BOOL_STRING(port, rx_power_high_warning,
-                            a2_data->alarm_warning_bits.rx_pwr_high_warning);
-            SET_BOOL_STRING(port, rx_power_low_warning,
-                            a2_data->alarm_warning_bits.rx_pwr_low_warning);
+            SET_READING_STRING(port, rx_power, rx_power);
 
             rx_power_high_alarm = (float) (a2_data->rx_power_high_alarm_msb<<8 |
                                   a2_data->rx_power_high_alarm_lsb) * 0.0001;
@@ -249,16 +1151,7 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
 
             //解析tx_power
             tx_power = (float) (a2_data->tx_power_msb<<8 | a2_data->tx_power_lsb) * 0.0001;
-            SET_FLOAT_STRING(port, tx_power, tx_power);
-
-            SET_BOOL_STRING(port, tx_power_high_alarm,
-                            a2_data->alarm_warning_bits.tx_pwr_high_alarm);
-            SET_BOOL_STRING(port, tx_power_low_alarm,
-                            a2_data->alarm_warning_bits.tx_pwr_low_alarm);
-            SET_BOOL_STRING(port, tx_power_high_warning,
-                            a2_data->alarm_warning_bits.tx_pwr_high_warning);
-            SET_BOOL_STRING(port, tx_power_low_warning,
-                            a2_data->alarm_warning_bits.tx_pwr_low_warning);
+            SET_READING_STRING(port, tx_power, tx_power);
 
             tx_power_high_alarm = (float) (a2_data->tx_power_high_alarm_msb<<8 |
                                    a2_data->tx_power_high_alarm_lsb) * 0.0001;
@@ -276,8 +1169,23 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
                                    a2_data->tx_power_low_warning_lsb) * 0.0001;
             SET_FLOAT_STRING(port, tx_power_low_warning_threshold, tx_power_low_warning);
 
-
-            SET_BINARY(port, a2, (char *)a2_data, sizeof(pm_sfp_dom_t));
+            pm_dom_set_flags(port, pm_sfp_dom_flags,
+                             ARRAY_SIZE(pm_sfp_dom_flags),
+                             (const unsigned char *)a2_data);
+
+            SET_READING_BINARY(port, a2, (char *)a2_data, sizeof(pm_sfp_dom_t));
+
+            sample.n_lanes = 1;
+            sample.has_tx_power = true;
+            sample.temperature = (int16_t)PM_DOM_RAW16(a2_data->temperature_msb,
+                                                       a2_data->temperature_lsb);
+            sample.vcc = PM_DOM_RAW16(a2_data->vcc_msb, a2_data->vcc_lsb);
+            sample.tx_bias[0] = PM_DOM_RAW16(a2_data->tx_bias_msb,
+                                             a2_data->tx_bias_lsb);
+            sample.tx_power[0] = PM_DOM_RAW16(a2_data->tx_power_msb,
+                                              a2_data->tx_power_lsb);
+            sample.rx_power[0] = PM_DOM_RAW16(a2_data->rx_power_msb,
+                                              a2_data->rx_power_lsb);
             break;
         case MODULE_TYPE_QSFP_PLUS:
         case MODULE_TYPE_QSFP28:
@@ -286,12 +1194,12 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
             //解析温度值
             temperature = (qsfp_a2_data->module_monitors.temp_msb +
                           (float)(qsfp_a2_data->module_monitors.temp_lsb/256));
-            SET_FLOAT_STRING(port, temperature, temperature);
+            SET_READING_STRING(port, temperature, temperature);
 
             //解析Vcc值
             vcc = (float) ((qsfp_a2_data->module_monitors.voltage_msb<<8) |
                            (qsfp_a2_data->module_monitors.voltage_lsb)) * 0.0001;
-            SET_FLOAT_STRING(port, vcc, vcc);
+            SET_READING_STRING(port, vcc, vcc);
 
             //每个车道分段偏置电流和接收功率
                          //
@@ -299,127 +1207,91 @@ pm_set_a2(pm_port_t *port, pm_sfp_dom_t *a2_data)
                            //解析tx_bias
             tx1_bias = (float) (qsfp_a2_data->channel_monitors.tx1_bias_msb<<8 |
                                 qsfp_a2_data->channel_monitors.tx1_bias_lsb) * 0.002;
-            SET_FLOAT_STRING(port, tx1_bias, tx1_bias);
-
-            SET_BOOL_STRING(port, tx1_bias_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx1_bias_high_alarm);
-            SET_BOOL_STRING(port, tx1_bias_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx1_bias_low_alarm);
-            SET_BOOL_STRING(port, tx1_bias_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx1_bias_high_warning);
-            SET_BOOL_STRING(port, tx1_bias_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx1_bias_low_warning);
+            SET_READING_STRING(port, tx1_bias, tx1_bias);
 
             //解析rx_power
             rx1_power = (float) (qsfp_a2_data->channel_monitors.rx1_power_msb<<8 |
                                  qsfp_a2_data->channel_monitors.rx1_power_lsb) * 0.0001;
-            SET_FLOAT_STRING(port, rx1_power, rx1_power);
-
-            SET_BOOL_STRING(port, rx1_power_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx1_power_high_alarm);
-            SET_BOOL_STRING(port, rx1_power_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx1_power_low_alarm);
-            SET_BOOL_STRING(port, rx1_power_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx1_power_high_warning);
-            SET_BOOL_STRING(port, rx1_power_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx1_power_low_warning);
+            SET_READING_STRING(port, rx1_power, rx1_power);
 
             // Lane 2
             //
             //解析tx_bias
             tx2_bias = (float) (qsfp_a2_data->channel_monitors.tx2_bias_msb<<8 |
                                 qsfp_a2_data->channel_monitors.tx2_bias_lsb) * 0.002;
-            SET_FLOAT_STRING(port, tx2_bias, tx2_bias);
-
-            SET_BOOL_STRING(port, tx2_bias_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx2_bias_high_alarm);
-            SET_BOOL_STRING(port, tx2_bias_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx2_bias_low_alarm);
-            SET_BOOL_STRING(port, tx2_bias_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx2_bias_high_warning);
-            SET_BOOL_STRING(port, tx2_bias_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx2_bias_low_warning);
-
+            SET_READING_STRING(port, tx2_bias, tx2_bias);
 
             //解析rx_power
             rx2_power = (float) (qsfp_a2_data->channel_monitors.rx2_power_msb<<8 |
                                  qsfp_a2_data->channel_monitors.rx2_power_lsb) * 0.0001;
-            SET_FLOAT_STRING(port, rx2_power, rx2_power);
-
-            SET_BOOL_STRING(port, rx2_power_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx2_power_high_alarm);
-            SET_BOOL_STRING(port, rx2_power_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx2_power_low_alarm);
-            SET_BOOL_STRING(port, rx2_power_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx2_power_high_warning);
-            SET_BOOL_STRING(port, rx2_power_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx2_power_low_warning);
+            SET_READING_STRING(port, rx2_power, rx2_power);
 
             // Lane 3
             //
                          //解析tx_bias
             tx3_bias = (float) (qsfp_a2_data->channel_monitors.tx3_bias_msb<<8 |
                                 qsfp_a2_data->channel_monitors.tx3_bias_lsb) * 0.002;
-            SET_FLOAT_STRING(port, tx3_bias, tx3_bias);
-
-            SET_BOOL_STRING(port, tx3_bias_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx3_bias_high_alarm);
-            SET_BOOL_STRING(port, tx3_bias_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx3_bias_low_alarm);
-            SET_BOOL_STRING(port, tx3_bias_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx3_bias_high_warning);
-            SET_BOOL_STRING(port, tx3_bias_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx3_bias_low_warning);
-
+            SET_READING_STRING(port, tx3_bias, tx3_bias);
 
             // Parsing rx_power
             rx3_power = (float) (qsfp_a2_data->channel_monitors.rx3_power_msb<<8 |
                                  qsfp_a2_data->channel_monitors.rx3_power_lsb) * 0.0001;
-            SET_FLOAT_STRING(port, rx3_power, rx3_power);
-
-            SET_BOOL_STRING(port, rx3_power_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx3_power_high_alarm);
-            SET_BOOL_STRING(port, rx3_power_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx3_power_low_alarm);
-            SET_BOOL_STRING(port, rx3_power_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx3_power_high_warning);
-            SET_BOOL_STRING(port, rx3_power_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx3_power_low_warning);
-
+            SET_READING_STRING(port, rx3_power, rx3_power);
 
             // Lane 4
             //
             // Parsing tx_bias
             tx4_bias = (float) (qsfp_a2_data->channel_monitors.tx4_bias_msb<<8 |
                                 qsfp_a2_data->channel_monitors.tx4_bias_lsb) * 0.002;
-            SET_FLOAT_STRING(port, tx4_bias, tx4_bias);
-
-            SET_BOOL_STRING(port, tx4_bias_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx4_bias_high_alarm);
-            SET_BOOL_STRING(port, tx4_bias_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_tx4_bias_low_alarm);
-            SET_BOOL_STRING(port, tx4_bias_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx4_bias_high_warning);
-            SET_BOOL_STRING(port, tx4_bias_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_tx4_bias_low_warning);
-
+            SET_READING_STRING(port, tx4_bias, tx4_bias);
 
             // Parsing rx_power
             rx4_power = (float) (qsfp_a2_data->channel_monitors.rx4_power_msb<<8 |
                                  qsfp_a2_data->channel_monitors.rx4_power_lsb) * 0.0001;
-            SET_FLOAT_STRING(port, rx4_power, rx4_power);
-
-            SET_BOOL_STRING(port, rx4_power_high_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx4_power_high_alarm);
-            SET_BOOL_STRING(port, rx4_power_low_alarm,
-                            qsfp_a2_data->interrupt_flags.latched_rx4_power_low_alarm);
-            SET_BOOL_STRING(port, rx4_power_high_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx4_power_high_warning);
-            SET_BOOL_STRING(port, rx4_power_low_warning,
-                            qsfp_a2_data->interrupt_flags.latched_rx4_power_low_warning);
-
-
-            SET_BINARY(port, a2, (char *)qsfp_a2_data, sizeof(pm_qsfp_dom_t));
+            SET_READING_STRING(port, rx4_power, rx4_power);
+
+            pm_dom_set_flags(port, pm_qsfp_dom_flags,
+                             ARRAY_SIZE(pm_qsfp_dom_flags),
+                             (const unsigned char *)qsfp_a2_data);
+
+            SET_READING_BINARY(port, a2, (char *)qsfp_a2_data, sizeof(pm_qsfp_dom_t));
+
+            // the lower page lays out rx power for lanes 1-4, then tx bias,
+            // then tx power
+            sample.n_lanes = 4;
+            sample.has_tx_power = pm_dom_has_tx_power(port, false);
+            sample.temperature =
+                (int16_t)PM_DOM_RAW16(qsfp_a2_data->module_monitors.temp_msb,
+                                      qsfp_a2_data->module_monitors.temp_lsb);
+            sample.vcc = PM_DOM_RAW16(qsfp_a2_data->module_monitors.voltage_msb,
+                                      qsfp_a2_data->module_monitors.voltage_lsb);
+            for (lane = 0; lane < 4; lane++) {
+                unsigned char *rx_power =
+                    &qsfp_a2_data->channel_monitors.rx1_power_msb + (2 * lane);
+                unsigned char *tx_bias =
+                    &qsfp_a2_data->channel_monitors.tx1_bias_msb + (2 * lane);
+                unsigned char *tx_power =
+                    &qsfp_a2_data->channel_monitors.tx1_power_msb + (2 * lane);
+
+                sample.rx_power[lane] = PM_DOM_RAW16(rx_power[0], rx_power[1]);
+                sample.tx_bias[lane] = PM_DOM_RAW16(tx_bias[0], tx_bias[1]);
+                if (sample.has_tx_power) {
+                    sample.tx_power[lane] = PM_DOM_RAW16(tx_power[0],
+                                                         tx_power[1]);
+                }
+            }
+            break;
+        case MODULE_TYPE_QSFP_DD:
+        case MODULE_TYPE_OSFP:
+            // a2_data is the lower page; the upper pages are in port->cmis
+            pm_cmis_set_dom(port, &sample);
+            SET_READING_BINARY(port, a2, (char *)a2_data, PM_DOM_PAGE_SIZE);
             break;
     }
+
+    // a flag or threshold that changed above marked the port changed, so
+    // it is published on this sweep; readings reach pm_info only as
+    // window aggregates
+    pm_dom_history_record(port, &sample);
+    pm_dom_stats_update(port, &sample);
 }
@@ -0,0 +1,207 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the cache of decoded module identities.
+ *
+ * Decoding a serial ID page yields the identity columns of a module
+ * (connector and speeds; the others are decoded on demand), whether it
+ * is optical and whether it has DOM. The result depends only on the page
+ * and on the form factor of the port, so it is kept in a daemon-wide
+ * cache keyed by a hash of both. A module read again after a failed step,
+ * re-inserted, or of the same part and serial number in another port of
+ * the same kind is set up from the cache without parsing. Only successful
+ * parses are cached: pm_parse() fails on port configuration, not on the
+ * page.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <hash.h>
+#include <hmap.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "pm_ident.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_ident);
+
+typedef struct {
+    struct hmap_node node;              // in pm_idents
+    char            *form;              // connector type of the port
+    unsigned char   a0[PM_SERIAL_ID_LEN];
+    struct ovs_module_info columns;     // PM_IDENT_FOR_EACH_COLUMN only
+    bool            optical;
+    bool            dom;                // DOM polling supported
+    bool            dom_external;       // SFP DOM externally calibrated
+    unsigned long long last_used;       // pm_ident_clock at last use
+    unsigned long long hits;
+} pm_ident_t;
+
+static struct hmap pm_idents = HMAP_INITIALIZER(&pm_idents);
+
+// ticks on every lookup, to find the least recently used entry
+static unsigned long long pm_ident_clock;
+
+static unsigned long long pm_ident_hits;
+static unsigned long long pm_ident_misses;
+static unsigned long long pm_ident_evictions;
+
+static uint32_t
+pm_ident_hash(const char *form, const unsigned char *a0)
+{
+    return hash_bytes(a0, PM_SERIAL_ID_LEN, hash_string(form, 0));
+}
+
+static pm_ident_t *
+pm_ident_find(const char *form, const unsigned char *a0)
+{
+    pm_ident_t *ident;
+
+    HMAP_FOR_EACH_WITH_HASH (ident, node, pm_ident_hash(form, a0),
+                             &pm_idents) {
+        if (0 == strcmp(ident->form, form) &&
+            0 == memcmp(ident->a0, a0, PM_SERIAL_ID_LEN)) {
+            return ident;
+        }
+    }
+
+    return NULL;
+}
+
+// identity columns pm_parse() sets, all static strings
+#define PM_IDENT_FOR_EACH_COLUMN(F) \
+    F(supported_speeds)             \
+    F(max_speed)                    \
+    F(connector)                    \
+    F(connector_status)
+
+static void
+pm_ident_free(pm_ident_t *ident)
+{
+    free(ident->form);
+    free(ident);
+}
+
+//
+// pm_ident_lookup: set up a port from the cache if its serial ID was
+//                  decoded before
+//
+// input: port structure, serial ID page
+//
+// output: true on a hit, with the identity columns, optical flag and DOM
+//         capability of the port set as pm_parse() and
+//         set_a2_read_request() would have
+//
+bool
+pm_ident_lookup(pm_port_t *port, const unsigned char *a0)
+{
+    pm_ident_t *ident;
+
+    ident = pm_ident_find(port->module_device->connector, a0);
+    if (NULL == ident) {
+        pm_ident_misses++;
+        return false;
+    }
+
+    pm_ident_hits++;
+    ident->hits++;
+    ident->last_used = ++pm_ident_clock;
+
+#define PM_IDENT_SET(FIELD) \
+    SET_CONST_STRING(port, FIELD, ident->columns.FIELD)
+    PM_IDENT_FOR_EACH_COLUMN(PM_IDENT_SET)
+#undef PM_IDENT_SET
+
+    port->optical = ident->optical;
+    pm_dom_set_capability(port, ident->dom, ident->dom_external);
+
+    VLOG_DBG("identity of port %s found in cache", port->instance);
+
+    return true;
+}
+
+//
+// pm_ident_store: remember what a port's serial ID decoded to, evicting
+//                 the least recently used entry if the cache is full
+//
+// input: port structure just set up from the page, serial ID page
+//
+// output: none
+//
+void
+pm_ident_store(const pm_port_t *port, const unsigned char *a0)
+{
+    const char  *form = port->module_device->connector;
+    pm_ident_t  *ident;
+    pm_ident_t  *oldest = NULL;
+
+    if (NULL != pm_ident_find(form, a0)) {
+        return;
+    }
+
+    if (hmap_count(&pm_idents) >= PM_IDENT_CACHE_SIZE) {
+        HMAP_FOR_EACH (ident, node, &pm_idents) {
+            if (NULL == oldest || ident->last_used < oldest->last_used) {
+                oldest = ident;
+            }
+        }
+        hmap_remove(&pm_idents, &oldest->node);
+        pm_ident_free(oldest);
+        pm_ident_evictions++;
+    }
+
+    ident = xzalloc(sizeof(*ident));
+    ident->form = xstrdup(form);
+    memcpy(ident->a0, a0, PM_SERIAL_ID_LEN);
+
+#define PM_IDENT_COPY(FIELD) \
+    ident->columns.FIELD = port->ovs_module_columns.FIELD;
+    PM_IDENT_FOR_EACH_COLUMN(PM_IDENT_COPY)
+#undef PM_IDENT_COPY
+
+    ident->optical = port->optical;
+    ident->dom = port->a2_read_requested;
+    ident->dom_external = port->dom.cal.external;
+    ident->last_used = ++pm_ident_clock;
+
+    hmap_insert(&pm_idents, &ident->node, pm_ident_hash(form, a0));
+}
+
+void
+pm_ident_dump(struct ds *ds)
+{
+    pm_ident_t *ident;
+
+    ds_put_cstr(ds, "================ Identity cache ================\n");
+    ds_put_format(ds, "entries %"PRIuSIZE"/%d, hits %llu, misses %llu, "
+                  "evictions %llu\n", hmap_count(&pm_idents),
+                  PM_IDENT_CACHE_SIZE, pm_ident_hits, pm_ident_misses,
+                  pm_ident_evictions);
+
+    HMAP_FOR_EACH (ident, node, &pm_idents) {
+        ds_put_format(ds, "    %-10s ", ident->form);
+        pm_id_describe(ds, ident->form, ident->a0);
+        ds_put_format(ds, " hits %llu\n", ident->hits);
+    }
+
+    pm_intern_dump(ds);
+}
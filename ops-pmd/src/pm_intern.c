@@ -0,0 +1,119 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the table of interned module identity strings.
+ *
+ * Vendor names, OUIs and part numbers repeat across a chassis populated
+ * with identical optics. Each distinct string is kept once, with a count
+ * of the ports referring to it; the last release frees it. The identity
+ * cache keeps only constant columns, so it holds no references. Strings
+ * unique to a module (revision, serial number) live in inline buffers of
+ * the port instead.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <hash.h>
+#include <hmap.h>
+#include <util.h>
+
+#include "pmd.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_intern);
+
+typedef struct {
+    struct hmap_node node;              // in pm_interns
+    unsigned int    refs;
+    char            string[];
+} pm_intern_t;
+
+static struct hmap pm_interns = HMAP_INITIALIZER(&pm_interns);
+
+static unsigned long long pm_intern_refs;
+static unsigned long long pm_intern_bytes;
+
+//
+// pm_intern: get the shared copy of a string, adding a reference to it
+//
+// input: string
+//
+// output: interned string, to be given back with pm_intern_release()
+//
+const char *
+pm_intern(const char *string)
+{
+    uint32_t    hash = hash_string(string, 0);
+    size_t      len;
+    pm_intern_t *intern;
+
+    HMAP_FOR_EACH_WITH_HASH (intern, node, hash, &pm_interns) {
+        if (0 == strcmp(intern->string, string)) {
+            intern->refs++;
+            pm_intern_refs++;
+            return intern->string;
+        }
+    }
+
+    len = strlen(string) + 1;
+    intern = xmalloc(sizeof(*intern) + len);
+    intern->refs = 1;
+    memcpy(intern->string, string, len);
+    hmap_insert(&pm_interns, &intern->node, hash);
+
+    pm_intern_refs++;
+    pm_intern_bytes += len;
+
+    return intern->string;
+}
+
+//
+// pm_intern_release: drop a reference to an interned string
+//
+// input: string returned by pm_intern(), or NULL
+//
+// output: none
+//
+void
+pm_intern_release(const char *string)
+{
+    pm_intern_t *intern;
+
+    if (NULL == string) {
+        return;
+    }
+
+    intern = CONTAINER_OF(CONST_CAST(char *, string), pm_intern_t, string);
+    pm_intern_refs--;
+    if (0 == --intern->refs) {
+        pm_intern_bytes -= strlen(intern->string) + 1;
+        hmap_remove(&pm_interns, &intern->node);
+        free(intern);
+    }
+}
+
+void
+pm_intern_dump(struct ds *ds)
+{
+    ds_put_format(ds, "interned strings %"PRIuSIZE" (%llu bytes), "
+                  "references %llu\n", hmap_count(&pm_interns),
+                  pm_intern_bytes, pm_intern_refs);
+}
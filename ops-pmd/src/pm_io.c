@@ -0,0 +1,511 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for batched EEPROM file I/O.
+ *
+ * A batch of reads and writes is handed to the kernel through an io_uring,
+ * so slow devices are accessed concurrently instead of one after another.
+ * The ring is driven with the raw system calls. If it cannot be set up,
+ * or --io-mode=serial is given, the batch is done with pread/pwrite in a
+ * loop.
+ *
+ * --io-latency=USECS delays every operation by USECS, to benchmark both
+ * paths against ordinary files. The serial path sleeps before each
+ * operation; the ring links a timeout in front of each one, so the delays
+ * overlap as real device latency would.
+ *
+ * With --op-deadline, the ring also links a timeout behind each operation,
+ * which cancels it once the deadline is past; its result is then
+ * -ETIMEDOUT. The serial path cannot interrupt an operation, so the
+ * backend layer only measures it.
+ ***************************************************************************/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "pmd.h"
+#include "pm_io.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_io);
+
+#define PM_IO_RING_ENTRIES      64
+#define PM_IO_TIMEOUT_TAG       UINT64_MAX
+#define PM_IO_DEADLINE_TAG      (UINT64_C(1) << 63)  // | operation index
+
+unsigned int pm_io_latency = 0;
+
+enum pm_io_mode {
+    PM_IO_URING,
+    PM_IO_SERIAL,
+};
+
+static const char *const pm_io_mode_names[] = {
+    [PM_IO_URING] = "io_uring",
+    [PM_IO_SERIAL] = "serial",
+};
+
+static enum pm_io_mode pm_io_mode = PM_IO_URING;
+
+static struct {
+    bool            tried;              // setup attempted
+    int             fd;
+    unsigned int    entries;
+    // mappings, for the teardown
+    void            *sq_ring;
+    size_t          sq_ring_size;
+    void            *cq_ring;           // NULL if shared with sq_ring
+    size_t          cq_ring_size;
+    size_t          sqes_size;
+    // submission queue
+    unsigned int    *sq_head;
+    unsigned int    *sq_tail;
+    unsigned int    sq_mask;
+    unsigned int    *sq_array;
+    struct io_uring_sqe *sqes;
+    // completion queue
+    unsigned int    *cq_head;
+    unsigned int    *cq_tail;
+    unsigned int    cq_mask;
+    struct io_uring_cqe *cqes;
+    // timeouts keep linked operations going (5.16 and later)
+    bool            link_timeouts;
+} pm_io_ring = { .fd = -1 };
+
+static struct {
+    unsigned long long batches;
+    unsigned long long ops;
+    long long int   total_usec;
+    long long int   max_usec;
+    long long int   last_usec;
+} pm_io_stats[ARRAY_SIZE(pm_io_mode_names)];
+
+int
+pm_io_set_mode(const char *mode)
+{
+    if (0 == strcmp(mode, "uring")) {
+        pm_io_mode = PM_IO_URING;
+    } else if (0 == strcmp(mode, "serial")) {
+        pm_io_mode = PM_IO_SERIAL;
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+//
+// pm_io_ring_teardown: unmap the queues and close the ring, which cancels
+//                      whatever it still holds; batches are then serial
+//
+static void
+pm_io_ring_teardown(void)
+{
+    if (NULL != pm_io_ring.sqes) {
+        munmap(pm_io_ring.sqes, pm_io_ring.sqes_size);
+    }
+    if (NULL != pm_io_ring.cq_ring) {
+        munmap(pm_io_ring.cq_ring, pm_io_ring.cq_ring_size);
+    }
+    if (NULL != pm_io_ring.sq_ring) {
+        munmap(pm_io_ring.sq_ring, pm_io_ring.sq_ring_size);
+    }
+    if (pm_io_ring.fd >= 0) {
+        close(pm_io_ring.fd);
+    }
+
+    pm_io_ring.fd = -1;
+    pm_io_ring.sq_ring = NULL;
+    pm_io_ring.cq_ring = NULL;
+    pm_io_ring.sqes = NULL;
+}
+
+//
+// pm_io_ring_setup: create the ring and map its queues
+//
+// output: 0 on success, -1 (with the ring left unused) on failure
+//
+static int
+pm_io_ring_setup(void)
+{
+    struct io_uring_params params;
+    size_t  sq_size;
+    size_t  cq_size;
+    void    *sq;
+    void    *cq;
+    void    *sqes;
+    int     fd;
+
+    memset(&params, 0, sizeof(params));
+
+    fd = syscall(__NR_io_uring_setup, PM_IO_RING_ENTRIES, &params);
+    if (fd < 0) {
+        VLOG_INFO("io_uring unavailable (%s), using serial I/O",
+                  ovs_strerror(errno));
+        return -1;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    cq_size = params.cq_off.cqes +
+              params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_size = cq_size = MAX(sq_size, cq_size);
+    }
+
+    pm_io_ring.fd = fd;
+
+    sq = mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+              fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == sq) {
+        goto error;
+    }
+    pm_io_ring.sq_ring = sq;
+    pm_io_ring.sq_ring_size = sq_size;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq = sq;
+    } else {
+        cq = mmap(NULL, cq_size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == cq) {
+            goto error;
+        }
+        pm_io_ring.cq_ring = cq;
+        pm_io_ring.cq_ring_size = cq_size;
+    }
+
+    pm_io_ring.sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = mmap(NULL, pm_io_ring.sqes_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (MAP_FAILED == sqes) {
+        goto error;
+    }
+
+    pm_io_ring.entries = params.sq_entries;
+    pm_io_ring.sq_head = (unsigned int *)((char *)sq + params.sq_off.head);
+    pm_io_ring.sq_tail = (unsigned int *)((char *)sq + params.sq_off.tail);
+    pm_io_ring.sq_mask = *(unsigned int *)((char *)sq +
+                                           params.sq_off.ring_mask);
+    pm_io_ring.sq_array = (unsigned int *)((char *)sq + params.sq_off.array);
+    pm_io_ring.sqes = sqes;
+    pm_io_ring.cq_head = (unsigned int *)((char *)cq + params.cq_off.head);
+    pm_io_ring.cq_tail = (unsigned int *)((char *)cq + params.cq_off.tail);
+    pm_io_ring.cq_mask = *(unsigned int *)((char *)cq +
+                                           params.cq_off.ring_mask);
+    pm_io_ring.cqes = (struct io_uring_cqe *)((char *)cq +
+                                              params.cq_off.cqes);
+    pm_io_ring.link_timeouts = true;
+
+    VLOG_INFO("using io_uring with %u entries", pm_io_ring.entries);
+    return 0;
+
+error:
+    VLOG_WARN("unable to map io_uring (%s), using serial I/O",
+              ovs_strerror(errno));
+    pm_io_ring_teardown();
+    return -1;
+}
+
+static void
+pm_io_sleep(void)
+{
+    struct timespec req;
+
+    if (0 == pm_io_latency) {
+        return;
+    }
+
+    req.tv_sec = pm_io_latency / 1000000;
+    req.tv_nsec = (pm_io_latency % 1000000) * 1000;
+    nanosleep(&req, NULL);
+}
+
+// wait a little for the kernel to post completions
+static void
+pm_io_nap(void)
+{
+    struct timespec req = { 0, 1000000 };
+
+    nanosleep(&req, NULL);
+}
+
+static void
+pm_io_one(struct pm_io *io)
+{
+    pm_io_sleep();
+
+    io->res = io->write ? pwrite(io->fd, io->buf, io->len, io->pos) :
+                          pread(io->fd, io->buf, io->len, io->pos);
+    if (io->res < 0) {
+        io->res = -errno;
+    }
+}
+
+static struct io_uring_sqe *
+pm_io_ring_sqe(unsigned int *tail)
+{
+    struct io_uring_sqe *sqe;
+    unsigned int idx = *tail & pm_io_ring.sq_mask;
+
+    sqe = &pm_io_ring.sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    pm_io_ring.sq_array[idx] = idx;
+    (*tail)++;
+
+    return sqe;
+}
+
+//
+// pm_io_ring_reap: take the completions the kernel has posted
+//
+// input: operations of the batch, count of sqes whose completion is
+//        pending (decremented)
+//
+// output: number of operations that completed
+//
+static size_t
+pm_io_ring_reap(struct pm_io *ios, unsigned int *in_flight)
+{
+    unsigned int    head = *pm_io_ring.cq_head;
+    size_t          done = 0;
+
+    while (head != __atomic_load_n(pm_io_ring.cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe;
+        struct pm_io *io;
+
+        cqe = &pm_io_ring.cqes[head & pm_io_ring.cq_mask];
+        head++;
+        (*in_flight)--;
+
+        if (PM_IO_TIMEOUT_TAG == cqe->user_data) {
+            continue;
+        }
+
+        // the deadline fired: the operation is (or will be) cancelled
+        if (cqe->user_data & PM_IO_DEADLINE_TAG) {
+            io = &ios[cqe->user_data & ~PM_IO_DEADLINE_TAG];
+            if (-ETIME == cqe->res && io->res < 0) {
+                io->res = -ETIMEDOUT;
+            }
+            continue;
+        }
+
+        io = &ios[cqe->user_data];
+        if (-ETIMEDOUT != io->res || cqe->res >= 0) {
+            io->res = cqe->res;
+        }
+        done++;
+    }
+    __atomic_store_n(pm_io_ring.cq_head, head, __ATOMIC_RELEASE);
+
+    return done;
+}
+
+//
+// pm_io_ring_submit: run a batch through the ring. Operations are queued
+//                    as long as their completions are sure to fit, and
+//                    the rest follow as earlier ones complete.
+//
+static void
+pm_io_ring_submit(struct pm_io *ios, size_t n)
+{
+    static struct __kernel_timespec delay;
+    static struct __kernel_timespec deadline;
+    struct io_uring_sqe *sqe;
+    bool            delayed = pm_io_latency && pm_io_ring.link_timeouts;
+    unsigned int    slots = 1 + delayed + (0 != pm_bus_deadline);
+    unsigned int    tail;
+    unsigned int    in_flight = 0;  // sqes whose completion is pending
+    unsigned int    queued;
+    unsigned int    to_submit = 0;  // queued but not yet taken by the kernel
+    size_t          next = 0;
+    size_t          done = 0;
+    size_t          idx;
+    int             rc;
+
+    delay.tv_sec = pm_io_latency / 1000000;
+    delay.tv_nsec = (pm_io_latency % 1000000) * 1000;
+    deadline.tv_sec = pm_bus_deadline / 1000;
+    deadline.tv_nsec = (pm_bus_deadline % 1000) * 1000000;
+
+    // deadline timeouts complete after their operation, so wait for
+    // everything in flight before leaving
+    while (done < n || in_flight > 0) {
+        tail = *pm_io_ring.sq_tail;
+        queued = 0;
+
+        while (next < n && in_flight + slots <= pm_io_ring.entries) {
+            if (delayed) {
+                sqe = pm_io_ring_sqe(&tail);
+                sqe->opcode = IORING_OP_TIMEOUT;
+                sqe->addr = (uintptr_t)&delay;
+                sqe->len = 1;
+                sqe->timeout_flags = IORING_TIMEOUT_ETIME_SUCCESS;
+                sqe->flags = IOSQE_IO_LINK;
+                sqe->user_data = PM_IO_TIMEOUT_TAG;
+            }
+
+            sqe = pm_io_ring_sqe(&tail);
+            sqe->opcode = ios[next].write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd = ios[next].fd;
+            sqe->addr = (uintptr_t)ios[next].buf;
+            sqe->len = ios[next].len;
+            sqe->off = ios[next].pos;
+            sqe->user_data = next;
+
+            if (0 != pm_bus_deadline) {
+                sqe->flags = IOSQE_IO_LINK;
+                sqe = pm_io_ring_sqe(&tail);
+                sqe->opcode = IORING_OP_LINK_TIMEOUT;
+                sqe->addr = (uintptr_t)&deadline;
+                sqe->len = 1;
+                sqe->user_data = PM_IO_DEADLINE_TAG | next;
+            }
+
+            in_flight += slots;
+            queued += slots;
+            next++;
+        }
+        __atomic_store_n(pm_io_ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+        to_submit += queued;
+        rc = syscall(__NR_io_uring_enter, pm_io_ring.fd, to_submit, 1,
+                     IORING_ENTER_GETEVENTS, NULL, 0);
+        if (rc >= 0) {
+            to_submit -= MIN((unsigned int)rc, to_submit);
+        } else if (EINTR != errno) {
+            VLOG_ERR("io_uring_enter failed (%s), using serial I/O",
+                     ovs_strerror(errno));
+            // operations the kernel has taken still write into their
+            // buffers, so wait for them; completions are posted to the
+            // mapped queue without entering the kernel. Only then can the
+            // ring go and the rest be done serially.
+            while (in_flight > to_submit) {
+                pm_io_ring_reap(ios, &in_flight);
+                if (in_flight > to_submit) {
+                    pm_io_nap();
+                }
+            }
+            pm_io_ring_teardown();
+            for (idx = 0; idx < n; idx++) {
+                if (-EINPROGRESS == ios[idx].res) {
+                    pm_io_one(&ios[idx]);
+                }
+            }
+            return;
+        }
+
+        done += pm_io_ring_reap(ios, &in_flight);
+    }
+
+    // kernels before 5.16 break the link when the delay fires; redo what
+    // it cancelled without the delay and stop linking
+    if (delayed) {
+        for (idx = 0; idx < n; idx++) {
+            if (-ECANCELED == ios[idx].res) {
+                pm_io_ring.link_timeouts = false;
+                pm_io_one(&ios[idx]);
+            }
+        }
+    }
+}
+
+//
+// pm_io_submit: perform a batch of reads and writes; each operation's
+//               result is left in its res field
+//
+// input: operations, count
+//
+// output: none
+//
+void
+pm_io_submit(struct pm_io *ios, size_t n)
+{
+    enum pm_io_mode mode = PM_IO_SERIAL;
+    long long int   start = pm_bus_usec();
+    long long int   elapsed;
+    size_t          idx;
+
+    for (idx = 0; idx < n; idx++) {
+        ios[idx].res = -EINPROGRESS;
+    }
+
+    // a single operation is not worth a trip through the ring
+    if (PM_IO_URING == pm_io_mode && n > 1) {
+        if (!pm_io_ring.tried) {
+            pm_io_ring.tried = true;
+            pm_io_ring_setup();
+        }
+        if (pm_io_ring.fd >= 0) {
+            mode = PM_IO_URING;
+        }
+    }
+
+    if (PM_IO_URING == mode) {
+        pm_io_ring_submit(ios, n);
+    } else {
+        for (idx = 0; idx < n; idx++) {
+            pm_io_one(&ios[idx]);
+        }
+    }
+
+    elapsed = pm_bus_usec() - start;
+    pm_io_stats[mode].batches++;
+    pm_io_stats[mode].ops += n;
+    pm_io_stats[mode].total_usec += elapsed;
+    pm_io_stats[mode].last_usec = elapsed;
+    if (elapsed > pm_io_stats[mode].max_usec) {
+        pm_io_stats[mode].max_usec = elapsed;
+    }
+}
+
+void
+pm_io_dump(struct ds *ds)
+{
+    size_t mode;
+
+    ds_put_cstr(ds, "================ EEPROM file I/O ================\n");
+    ds_put_format(ds, "mode %s%s, injected latency %uus, deadline %ums\n",
+                  pm_io_mode_names[pm_io_mode],
+                  (PM_IO_URING == pm_io_mode && pm_io_ring.tried &&
+                   pm_io_ring.fd < 0) ? " (unavailable)" : "",
+                  pm_io_latency, pm_bus_deadline);
+
+    for (mode = 0; mode < ARRAY_SIZE(pm_io_stats); mode++) {
+        if (0 == pm_io_stats[mode].batches) {
+            continue;
+        }
+        ds_put_format(ds, "    %-8s batches %llu, ops %llu, "
+                      "avg %lldus, max %lldus, last %lldus\n",
+                      pm_io_mode_names[mode], pm_io_stats[mode].batches,
+                      pm_io_stats[mode].ops,
+                      pm_io_stats[mode].total_usec /
+                          (long long int)pm_io_stats[mode].batches,
+                      pm_io_stats[mode].max_usec, pm_io_stats[mode].last_usec);
+    }
+}
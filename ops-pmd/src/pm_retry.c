@@ -0,0 +1,197 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for pluggable module access retries and circuit breakers.
+ *
+ * Within a sweep, a failed access is retried a bounded number of times
+ * with a short, doubling pause, which is usually enough for a module busy
+ * with an internal write cycle. A serial ID region that fails its check
+ * code is read again the same way, with longer pauses, as the module may
+ * still be loading it.
+ *
+ * Across sweeps, each port has a circuit breaker. After
+ * PM_BREAKER_THRESHOLD sweeps in a row in which its module could not be
+ * read, the port is parked: its EEPROM is left alone until a probe is due.
+ * A successful probe closes the breaker; a failed one parks the port again
+ * for twice as long, up to PM_BREAKER_PROBE_MAX. Inserting a module closes
+ * the breaker, so a replacement is read right away.
+ ***************************************************************************/
+
+#include <string.h>
+
+#include <util.h>
+
+#include "pmd.h"
+#include "pm_retry.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_retry);
+
+const pm_retry_policy_t pm_retry_presence = {
+    .attempts = 3,
+    .backoff_usec = 0,
+};
+
+const pm_retry_policy_t pm_retry_eeprom = {
+    .attempts = 3,
+    .backoff_usec = 500,
+};
+
+const pm_retry_policy_t pm_retry_checksum = {
+    .attempts = 3,
+    .backoff_usec = 2000,
+};
+
+static const char *const pm_breaker_state_names[] = {
+    [PM_BREAKER_CLOSED] = "closed",
+    [PM_BREAKER_OPEN] = "parked",
+    [PM_BREAKER_HALF_OPEN] = "probing",
+};
+
+//
+// pm_retry_again: decide whether a failed access is tried again, pausing
+//                 first as the policy asks
+//
+// input: policy, number of the attempt that failed (1 for the first),
+//        advanced if another attempt follows
+//
+// output: true if the access should be tried again
+//
+bool
+pm_retry_again(const pm_retry_policy_t *policy, unsigned int *attempt)
+{
+    if (*attempt >= policy->attempts) {
+        return false;
+    }
+
+    if (0 != policy->backoff_usec) {
+        xnanosleep((uint64_t)(policy->backoff_usec << (*attempt - 1)) * 1000);
+    }
+    (*attempt)++;
+
+    return true;
+}
+
+void
+pm_breaker_reset(pm_breaker_t *breaker)
+{
+    bool present = breaker->present;
+    unsigned int trips = breaker->trips;
+    unsigned long long skipped = breaker->skipped;
+
+    memset(breaker, 0, sizeof(*breaker));
+    breaker->present = present;
+    breaker->trips = trips;
+    breaker->skipped = skipped;
+}
+
+//
+// pm_breaker_presence: note the module presence seen this sweep; a newly
+//                      inserted module starts with a closed breaker
+//
+void
+pm_breaker_presence(pm_breaker_t *breaker, bool present)
+{
+    if (present && !breaker->present) {
+        pm_breaker_reset(breaker);
+    }
+    breaker->present = present;
+}
+
+//
+// pm_breaker_due: tell whether the module would be accessed now, without
+//                 changing the breaker
+//
+bool
+pm_breaker_due(const pm_breaker_t *breaker, long long int now)
+{
+    return PM_BREAKER_OPEN != breaker->state || now >= breaker->next_probe;
+}
+
+//
+// pm_breaker_allow: decide whether to access the module this sweep
+//
+// input: breaker, monotonic time in msecs
+//
+// output: true if the module should be accessed
+//
+bool
+pm_breaker_allow(pm_breaker_t *breaker, long long int now)
+{
+    if (!pm_breaker_due(breaker, now)) {
+        breaker->skipped++;
+        return false;
+    }
+
+    if (PM_BREAKER_OPEN == breaker->state) {
+        breaker->state = PM_BREAKER_HALF_OPEN;
+    }
+
+    return true;
+}
+
+void
+pm_breaker_success(pm_breaker_t *breaker, const char *instance)
+{
+    if (PM_BREAKER_CLOSED != breaker->state) {
+        VLOG_INFO("module on port %s is readable again", instance);
+    }
+
+    breaker->state = PM_BREAKER_CLOSED;
+    breaker->failures = 0;
+    breaker->probe_interval = 0;
+}
+
+void
+pm_breaker_failure(pm_breaker_t *breaker, const char *instance,
+                   long long int now)
+{
+    breaker->failures++;
+
+    if (PM_BREAKER_HALF_OPEN == breaker->state) {
+        breaker->probe_interval = MIN(breaker->probe_interval * 2,
+                                      PM_BREAKER_PROBE_MAX);
+    } else if (PM_BREAKER_CLOSED == breaker->state &&
+               breaker->failures >= PM_BREAKER_THRESHOLD) {
+        breaker->probe_interval = PM_BREAKER_PROBE_MIN;
+        breaker->trips++;
+        VLOG_WARN("module on port %s failed %u sweeps in a row, "
+                  "probing every %llds", instance, breaker->failures,
+                  breaker->probe_interval / 1000);
+    } else {
+        return;
+    }
+
+    breaker->state = PM_BREAKER_OPEN;
+    breaker->next_probe = now + breaker->probe_interval;
+}
+
+void
+pm_breaker_dump(struct ds *ds, const pm_breaker_t *breaker, long long int now)
+{
+    ds_put_format(ds, "    circuit_breaker        = %s",
+                  pm_breaker_state_names[breaker->state]);
+    if (PM_BREAKER_OPEN == breaker->state) {
+        ds_put_format(ds, ", next probe in %lldms",
+                      MAX(breaker->next_probe - now, 0));
+    }
+    ds_put_format(ds, " (failures %u, trips %u, skipped %llu)\n",
+                  breaker->failures, breaker->trips, breaker->skipped);
+}
@@ -0,0 +1,339 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the module identity snapshot kept across restarts.
+ *
+ * Identifying every module takes a full serial ID read per port, so the
+ * first database update of a freshly started daemon used to wait for all
+ * of them. Whenever an identity changes, the daemon now writes each port's
+ * presence and serial ID page (with a hash of it) to a small binary file,
+ * by default <OVS run dir>/ops-pmd.snapshot, replaced atomically through a
+ * rename. On start, a port whose record is found is decoded from the
+ * stored page, through the identity cache, without touching the bus, and
+ * published in the first update. Once that update is out, each restored
+ * port is checked with a read of the vendor serial number only; a module
+ * that does not match is read and decoded in full, as a new one would be.
+ ***************************************************************************/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <dirs.h>
+#include <hash.h>
+#include <shash.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "pm_snapshot.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_snapshot);
+
+extern struct shash ovs_intfs;
+
+struct pm_snapshot_header {
+    uint32_t        magic;
+    uint32_t        version;
+    uint32_t        count;              // records that follow
+    uint32_t        record_size;
+};
+
+struct pm_snapshot_record {
+    char            instance[PM_SNAPSHOT_INSTANCE_LEN];
+    char            form[PM_SNAPSHOT_FORM_LEN];     // connector of the port
+    uint8_t         present;            // identified when taken
+    uint8_t         pad[3];
+    uint32_t        hash;               // of a0, to catch corruption
+    uint8_t         a0[PM_SERIAL_ID_LEN];
+};
+
+BUILD_ASSERT_DECL(sizeof(struct pm_snapshot_record) % 4 == 0);
+
+// snapshot file; NULL for the default, "" to disable snapshots
+char *pm_snapshot_file = NULL;
+
+// records loaded at start and not yet claimed by a port
+static struct shash pm_snapshot_records =
+    SHASH_INITIALIZER(&pm_snapshot_records);
+
+static bool pm_snapshot_dirty;
+static bool pm_snapshot_live;           // restored state was published
+
+static unsigned int pm_snapshot_loaded;
+static unsigned int pm_snapshot_restored;
+static unsigned int pm_snapshot_matched;
+static unsigned int pm_snapshot_replaced;
+static unsigned int pm_snapshot_saves;
+static unsigned int pm_snapshot_save_errors;
+
+//
+// pm_snapshot_path: name of the snapshot file
+//
+// output: allocated path, or NULL if snapshots are disabled
+//
+static char *
+pm_snapshot_path(void)
+{
+    if (NULL == pm_snapshot_file) {
+        return xasprintf("%s/%s", ovs_rundir(), PM_SNAPSHOT_NAME);
+    }
+    if ('\0' == pm_snapshot_file[0]) {
+        return NULL;
+    }
+    return xstrdup(pm_snapshot_file);
+}
+
+//
+// pm_snapshot_load: read the snapshot left by the previous run, if any
+//
+// input: none
+//
+// output: none
+//
+void
+pm_snapshot_load(void)
+{
+    struct pm_snapshot_header header;
+    struct pm_snapshot_record record;
+    char        *path = pm_snapshot_path();
+    FILE        *file;
+    uint32_t    idx;
+
+    if (NULL == path) {
+        return;
+    }
+
+    file = fopen(path, "rb");
+    if (NULL == file) {
+        if (ENOENT != errno) {
+            VLOG_WARN("unable to open snapshot %s (%s)", path,
+                      ovs_strerror(errno));
+        }
+        free(path);
+        return;
+    }
+
+    if (1 != fread(&header, sizeof(header), 1, file) ||
+        PM_SNAPSHOT_MAGIC != header.magic ||
+        PM_SNAPSHOT_VERSION != header.version ||
+        sizeof(record) != header.record_size) {
+        VLOG_WARN("ignoring snapshot %s: not a version %d snapshot",
+                  path, PM_SNAPSHOT_VERSION);
+        goto end;
+    }
+
+    for (idx = 0; idx < header.count; idx++) {
+        if (1 != fread(&record, sizeof(record), 1, file)) {
+            VLOG_WARN("snapshot %s is truncated", path);
+            break;
+        }
+        record.instance[sizeof(record.instance) - 1] = '\0';
+        record.form[sizeof(record.form) - 1] = '\0';
+
+        if (!record.present ||
+            hash_bytes(record.a0, sizeof(record.a0), 0) != record.hash) {
+            continue;
+        }
+        if (shash_add_once(&pm_snapshot_records, record.instance,
+                           xmemdup(&record, sizeof(record)))) {
+            pm_snapshot_loaded++;
+        }
+    }
+
+    VLOG_INFO("loaded %u module identities from %s", pm_snapshot_loaded,
+              path);
+
+end:
+    fclose(file);
+    free(path);
+}
+
+//
+// pm_snapshot_take: claim the snapshot record of a port being created
+//
+// input: interface name, connector type of the port, page to fill in
+//
+// output: true with the serial ID page the module had in a0, if the port
+//         had an identified module of the same form factor
+//
+bool
+pm_snapshot_take(const char *instance, const char *form, unsigned char *a0)
+{
+    struct pm_snapshot_record *record;
+    bool        found = false;
+
+    record = shash_find_and_delete(&pm_snapshot_records, instance);
+    if (NULL == record) {
+        return false;
+    }
+
+    if (0 == strcmp(record->form, form)) {
+        memcpy(a0, record->a0, PM_SERIAL_ID_LEN);
+        pm_snapshot_restored++;
+        found = true;
+    }
+
+    free(record);
+    return found;
+}
+
+//
+// pm_snapshot_published: note that restored identities reached the
+//                        database, so they may be verified
+//
+void
+pm_snapshot_published(void)
+{
+    pm_snapshot_live = true;
+}
+
+bool
+pm_snapshot_verifying(void)
+{
+    return pm_snapshot_live;
+}
+
+//
+// pm_snapshot_verified: account for the check of a restored port
+//
+// input: interface name, whether the module matched its record
+//
+// output: none
+//
+void
+pm_snapshot_verified(const char *instance, bool match)
+{
+    if (match) {
+        pm_snapshot_matched++;
+    } else {
+        pm_snapshot_replaced++;
+        VLOG_INFO("module of port %s does not match the snapshot", instance);
+    }
+}
+
+void
+pm_snapshot_changed(void)
+{
+    pm_snapshot_dirty = true;
+}
+
+//
+// pm_snapshot_save: write the identities of all ports, if any changed
+//                   since the last save
+//
+// input: none
+//
+// output: none
+//
+void
+pm_snapshot_save(void)
+{
+    struct pm_snapshot_header header;
+    struct pm_snapshot_record *records;
+    struct shash_node *node;
+    char        *path;
+    char        *tmp;
+    FILE        *file;
+    size_t      count = 0;
+    bool        ok;
+
+    if (!pm_snapshot_dirty) {
+        return;
+    }
+    pm_snapshot_dirty = false;
+
+    path = pm_snapshot_path();
+    if (NULL == path) {
+        return;
+    }
+
+    records = xcalloc(MAX(shash_count(&ovs_intfs), 1), sizeof(*records));
+    SHASH_FOR_EACH (node, &ovs_intfs) {
+        pm_port_t *port = node->data;
+        struct pm_snapshot_record *record = &records[count];
+
+        if (strlen(port->instance) >= sizeof(record->instance) ||
+            strlen(port->module_device->connector) >= sizeof(record->form)) {
+            continue;
+        }
+        strcpy(record->instance, port->instance);
+        strcpy(record->form, port->module_device->connector);
+        record->present = port->present && !port->retry;
+        if (record->present) {
+            memcpy(record->a0, port->serial_id, sizeof(record->a0));
+        }
+        record->hash = hash_bytes(record->a0, sizeof(record->a0), 0);
+        count++;
+    }
+
+    header.magic = PM_SNAPSHOT_MAGIC;
+    header.version = PM_SNAPSHOT_VERSION;
+    header.count = count;
+    header.record_size = sizeof(*records);
+
+    tmp = xasprintf("%s.tmp", path);
+    file = fopen(tmp, "wb");
+    ok = (NULL != file);
+    if (ok) {
+        ok = (1 == fwrite(&header, sizeof(header), 1, file) &&
+              count == fwrite(records, sizeof(*records), count, file));
+        ok = (0 == fclose(file)) && ok;
+    }
+    if (ok && 0 != rename(tmp, path)) {
+        ok = false;
+    }
+
+    if (ok) {
+        pm_snapshot_saves++;
+    } else {
+        VLOG_WARN("unable to write snapshot %s (%s)", path,
+                  ovs_strerror(errno));
+        pm_snapshot_save_errors++;
+        unlink(tmp);
+    }
+
+    free(tmp);
+    free(path);
+    free(records);
+}
+
+void
+pm_snapshot_dump(struct ds *ds)
+{
+    char *path = pm_snapshot_path();
+
+    ds_put_cstr(ds, "================ Snapshot ================\n");
+    ds_put_format(ds, "file %s\n", path ? path : "(disabled)");
+    ds_put_format(ds, "loaded %u, unclaimed %"PRIuSIZE", restored %u, "
+                  "matched %u, replaced %u%s\n",
+                  pm_snapshot_loaded, shash_count(&pm_snapshot_records),
+                  pm_snapshot_restored, pm_snapshot_matched,
+                  pm_snapshot_replaced,
+                  pm_snapshot_live ? "" : " (not yet published)");
+    ds_put_format(ds, "saves %u, errors %u%s\n", pm_snapshot_saves,
+                  pm_snapshot_save_errors,
+                  pm_snapshot_dirty ? ", save pending" : "");
+
+    free(path);
+}
@@ -0,0 +1,373 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-pmd
+ *
+ * @file
+ * Source file for the upper page cache of QSFP modules.
+ *
+ * Once a module is identified, the pages it provides out of 00h-03h are
+ * read a single time and published in pm_info:a0_uppers: page 00h is the
+ * serial ID page read for identification, the others cost a page select
+ * each. The user EEPROM page is only read when requested
+ * (ops-pmd/upper-page). Page selects are only written when they change,
+ * and a refresh leaves the module on page 00h, where identification
+ * expects it, so between refreshes no page select is written at all.
+ * Paged backends (optoe) reach pages by number and get no page selects.
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vswitch-idl.h>
+#include <openswitch-idl.h>
+#include <shash.h>
+#include <util.h>
+
+#include "pmd.h"
+#include "plug.h"
+#include "pm_backend.h"
+#include "pm_upper.h"
+
+VLOG_DEFINE_THIS_MODULE(pm_upper);
+
+extern struct shash ovs_intfs;
+
+BUILD_ASSERT_DECL(sizeof(pm_qsfp_serial_id_t) == PM_UPPER_PAGE_SIZE);
+BUILD_ASSERT_DECL(PM_UPPER_PAGE_SIZE == PM_SERIAL_ID_LEN);
+BUILD_ASSERT_DECL(PM_SFF_IN(pm_qsfp_serial_id_t, options,
+                            PM_QSFP_PAGE_01H_PROVIDED_OFFSET));
+BUILD_ASSERT_DECL(PM_SFF_IN(pm_qsfp_serial_id_t, options,
+                            PM_QSFP_PAGE_02H_PROVIDED_OFFSET));
+BUILD_ASSERT_DECL(PM_SFF_IN(pm_qsfp_dom_t, status,
+                            PM_QSFP_FLAT_MEMORY_OFFSET));
+
+void
+pm_upper_init(pm_port_t *port)
+{
+    const char *connector = port->module_device->connector;
+
+    if (NULL == connector ||
+        (0 != strcmp(connector, CONNECTOR_QSFP_PLUS) &&
+         0 != strcmp(connector, CONNECTOR_QSFP28))) {
+        return;
+    }
+
+    port->upper = xzalloc(sizeof(*port->upper));
+
+    // refreshes leave modules on page 00h, and so did earlier releases
+    port->upper->selected = true;
+    port->upper->page = PM_UPPER_SERIAL_ID;
+}
+
+void
+pm_upper_destroy(pm_port_t *port)
+{
+    free(port->upper);
+    port->upper = NULL;
+}
+
+//
+// pm_upper_forget: forget the page select of a module whose state is not
+//                  known, after a failed access or a reset
+//
+void
+pm_upper_forget(pm_port_t *port)
+{
+    if (NULL != port->upper) {
+        port->upper->selected = false;
+    }
+}
+
+//
+// pm_upper_reset: forget the pages of the module a port held, so those of
+//                 the next one are read and published
+//
+void
+pm_upper_reset(pm_port_t *port)
+{
+    pm_upper_t *upper = port->upper;
+
+    if (NULL == upper) {
+        return;
+    }
+
+    upper->probed = false;
+    upper->provided = 0;
+    upper->loaded = 0;
+    upper->requested = 0;
+    memset(upper->pages, 0, sizeof(upper->pages));
+    DELETE_FREE(port, a0_uppers);
+}
+
+bool
+pm_upper_selected(const pm_port_t *port, uint8_t page)
+{
+    const pm_upper_t *upper = port->upper;
+
+    return NULL == upper || pm_backend_paged(port) ||
+           (upper->selected && upper->page == page);
+}
+
+//
+// pm_upper_select: make an upper page accessible, unless it already is
+//
+// input: port structure, page
+//
+// output: 0 on success, non-zero on failure
+//
+static int
+pm_upper_select(pm_port_t *port, uint8_t page)
+{
+    pm_upper_t  *upper = port->upper;
+    int         rc;
+
+    if (pm_upper_selected(port, page)) {
+        upper->n_skipped++;
+        return 0;
+    }
+
+    rc = pm_backend_write(port, PM_EEPROM_A0, 0, PM_UPPER_PAGE_SELECT,
+                          sizeof(page), &page);
+    upper->n_selects++;
+
+    upper->selected = (0 == rc);
+    upper->page = page;
+
+    return rc;
+}
+
+//
+// pm_upper_read: read a byte range of a module, selecting the upper page
+//                first if the range is in one
+//
+// input: port structure, page, offset, length, buffer
+//
+// output: 0 on success, non-zero on failure
+//
+int
+pm_upper_read(pm_port_t *port, uint8_t page, size_t offset, size_t len,
+              unsigned char *data)
+{
+    int rc = 0;
+
+    if (NULL != port->upper && offset + len > PM_UPPER_OFFSET) {
+        rc = pm_upper_select(port, page);
+    }
+    if (0 == rc) {
+        rc = pm_backend_read(port, PM_EEPROM_A0, page, offset, len, data);
+    }
+
+    // the module may have been reset under us
+    if (0 != rc) {
+        pm_upper_forget(port);
+    }
+
+    return rc;
+}
+
+//
+// pm_upper_probe: find out which pages a newly identified module provides
+//
+// input: port structure
+//
+// output: 0 on success, non-zero on failure
+//
+static int
+pm_upper_probe(pm_port_t *port)
+{
+    pm_upper_t      *upper = port->upper;
+    unsigned char   status;
+    int             rc;
+
+    rc = pm_backend_read(port, PM_EEPROM_A0, 0, PM_QSFP_FLAT_MEMORY_OFFSET,
+                         sizeof(status), &status);
+    if (0 != rc) {
+        pm_upper_forget(port);
+        return rc;
+    }
+
+    // page 00h is the serial ID page the module was identified from
+    upper->provided = 1u << PM_UPPER_SERIAL_ID;
+    memcpy(upper->pages[PM_UPPER_SERIAL_ID], port->serial_id,
+           PM_UPPER_PAGE_SIZE);
+    upper->loaded = 1u << PM_UPPER_SERIAL_ID;
+
+    // flat memory modules have page 00h alone
+    if (0 == (status & PM_QSFP_FLAT_MEMORY_MASK)) {
+        if (PM_SFF_TEST(port->serial_id, PM_QSFP_PAGE_01H_PROVIDED)) {
+            upper->provided |= 1u << PM_UPPER_APPLICATIONS;
+        }
+        if (PM_SFF_TEST(port->serial_id, PM_QSFP_PAGE_02H_PROVIDED)) {
+            upper->provided |= 1u << PM_UPPER_USER_EEPROM;
+        }
+        upper->provided |= 1u << PM_UPPER_THRESHOLDS;
+    }
+    upper->probed = true;
+
+    return 0;
+}
+
+static unsigned int
+pm_upper_due_pages(const pm_upper_t *upper)
+{
+    return upper->provided &
+           ((PM_UPPER_STATIC & ~upper->loaded) | upper->requested);
+}
+
+//
+// pm_upper_due: whether a port has upper pages to read
+//
+bool
+pm_upper_due(const pm_port_t *port)
+{
+    const pm_upper_t *upper = port->upper;
+
+    return NULL != upper && (!upper->probed || 0 != pm_upper_due_pages(upper));
+}
+
+//
+// pm_upper_publish: set a0_uppers from the pages read so far. Pages are
+//                   placed by page number, up to the last one read; any
+//                   before it the module does not provide are zero.
+//
+static void
+pm_upper_publish(pm_port_t *port)
+{
+    const pm_upper_t    *upper = port->upper;
+    unsigned char       image[PM_UPPER_N_PAGES * PM_UPPER_PAGE_SIZE];
+    size_t              n_pages = 0;
+    size_t              idx;
+
+    memset(image, 0, sizeof(image));
+    for (idx = 0; idx < PM_UPPER_N_PAGES; idx++) {
+        if (upper->loaded & (1u << idx)) {
+            memcpy(image + idx * PM_UPPER_PAGE_SIZE, upper->pages[idx],
+                   PM_UPPER_PAGE_SIZE);
+            n_pages = idx + 1;
+        }
+    }
+
+    SET_BINARY(port, a0_uppers, (char *)image, n_pages * PM_UPPER_PAGE_SIZE);
+}
+
+//
+// pm_upper_refresh: read the upper pages that are due and publish them
+//
+// input: port structure
+//
+// output: 0 on success, -1 if a read failed
+//
+int
+pm_upper_refresh(pm_port_t *port)
+{
+    pm_upper_t      *upper = port->upper;
+    unsigned int    due;
+    unsigned int    page;
+    int             rc = 0;
+
+    if (!upper->probed && 0 != pm_upper_probe(port)) {
+        return -1;
+    }
+
+    due = pm_upper_due_pages(upper);
+    for (page = 0; page < PM_UPPER_N_PAGES; page++) {
+        if (0 == (due & (1u << page))) {
+            continue;
+        }
+        if (0 != pm_upper_read(port, page, PM_UPPER_OFFSET,
+                               PM_UPPER_PAGE_SIZE, upper->pages[page])) {
+            rc = -1;
+            continue;
+        }
+        upper->loaded |= 1u << page;
+        upper->requested &= ~(1u << page);
+    }
+
+    // back to the serial ID page for identification reads
+    if (0 == rc && 0 != pm_upper_select(port, PM_UPPER_SERIAL_ID)) {
+        pm_upper_forget(port);
+        rc = -1;
+    }
+
+    // requests for pages the module does not have are dropped
+    upper->requested &= upper->provided;
+
+    pm_upper_publish(port);
+
+    return rc;
+}
+
+//
+// pm_upper_request: have an upper page of an interface read on the next
+//                   sweep
+//
+// input: dynamic string for the reply, interface name, page
+//
+// output: 0 on success, -1 on error, described in the reply
+//
+int
+pm_upper_request(struct ds *ds, const char *name, unsigned int page)
+{
+    pm_port_t *port;
+
+    port = shash_find_data(&ovs_intfs, name);
+    if (NULL == port) {
+        ds_put_cstr(ds, "No such interface");
+        return -1;
+    }
+    if (NULL == port->upper) {
+        ds_put_format(ds, "Interface %s has no QSFP upper pages",
+                      port->instance);
+        return -1;
+    }
+    if (page >= PM_UPPER_N_PAGES) {
+        ds_put_format(ds, "Invalid page, 0 to %d", PM_UPPER_N_PAGES - 1);
+        return -1;
+    }
+
+    port->upper->requested |= 1u << page;
+    ds_put_format(ds, "Upper page %02xh of Interface %s will be read on the "
+                  "next sweep and published in pm_info:a0_uppers\n", page,
+                  port->instance);
+
+    return 0;
+}
+
+void
+pm_upper_dump(struct ds *ds, const pm_port_t *port)
+{
+    const pm_upper_t    *upper = port->upper;
+    size_t              idx;
+
+    if (NULL == upper) {
+        return;
+    }
+
+    ds_put_format(ds, "    page selects           = %llu written, "
+                  "%llu skipped\n", upper->n_selects, upper->n_skipped);
+    ds_put_cstr(ds, "    upper pages loaded     =");
+    for (idx = 0; idx < PM_UPPER_N_PAGES; idx++) {
+        if (upper->loaded & (1u << idx)) {
+            ds_put_format(ds, " %02zxh", idx);
+        }
+    }
+    if (upper->probed && upper->provided == 1u << PM_UPPER_SERIAL_ID) {
+        ds_put_cstr(ds, " (flat memory)");
+    }
+    ds_put_cstr(ds, "\n");
+}
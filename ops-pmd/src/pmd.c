@@ -45,15 +45,18 @@
 #include <coverage.h>
 
 #include "pmd.h"
+#include "pm_backend.h"
+#include "pm_io.h"
+#include "pm_snapshot.h"
+#include "pm_upper.h"
 
 VLOG_DEFINE_THIS_MODULE(ops_pmd);
 
 COVERAGE_DEFINE(pmd_reconfigure);
 
 static unixctl_cb_func pmd_unixctl_dump;
-#ifdef PLATFORM_SIMULATION
-static unixctl_cb_func pmd_unixctl_sim;
-#endif
+static unixctl_cb_func pmd_unixctl_dom_history;
+static unixctl_cb_func pmd_unixctl_upper_page;
 static unixctl_cb_func ops_pmd_exit;
 
 static char *parse_options(int argc, char *argv[], char **unixctl_path);
@@ -64,21 +67,21 @@ static char *program_version = "0.02";
 
 extern struct ovsdb_idl *idl;
 extern void pmd_reconfigure(struct ovsdb_idl *idl);
-extern int pmd_sim_insert(const char *name, const char *file, struct ds *ds);
-extern int pmd_sim_remove(const char *name, struct ds *ds);
 
 static void
 pmd_init(const char *remote)
 {
     pm_config_init();
+    pm_snapshot_load();
     pm_ovsdb_if_init(remote);
-    unixctl_command_register("ops-pmd/dump", "", 0, 2,
+    unixctl_command_register("ops-pmd/dump", "[interface [name] | bus | io | ident | snapshot]", 0, 2,
                              pmd_unixctl_dump, NULL);
+    unixctl_command_register("ops-pmd/dom-history", "interface [n]", 1, 2,
+                             pmd_unixctl_dom_history, NULL);
+    unixctl_command_register("ops-pmd/upper-page", "interface page", 2, 2,
+                             pmd_unixctl_upper_page, NULL);
 
-#ifdef PLATFORM_SIMULATION
-    unixctl_command_register("ops-pmd/sim", "", 2, 3,
-                             pmd_unixctl_sim, NULL);
-#endif
+    pm_backend_init();
 }
 
 static void
@@ -131,30 +134,36 @@ pmd_wait(void)
     poll_timer_wait_at(PM_INTERVAL, __FUNCTION__);
 }
 
-#ifdef PLATFORM_SIMULATION
 static void
-pmd_unixctl_sim(struct unixctl_conn *conn, int argc,
-                const char *argv[], void *aux OVS_UNUSED)
+pmd_unixctl_dump(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                 const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
 {
     struct ds ds = DS_EMPTY_INITIALIZER;
 
-    int rc = 0;
-    const char *interface = argv[1];
+    pm_debug_dump(&ds, argc, argv);
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+}
 
-    /* 用法:
-        ops-pmd/sim <interface> insert <file>
-        ops-pmd/sim <interface> remove
+static void
+pmd_unixctl_dom_history(struct unixctl_conn *conn, int argc,
+                        const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    unsigned int n = 0;
+    int rc;
+
+    /* usage:
+        ops-pmd/dom-history <interface> [n]
     */
-    if (4 == argc && strcmp("insert", argv[2]) == 0) {
-        rc = pmd_sim_insert(interface, argv[3], &ds);
-    } else if (3 == argc && strcmp("remove", argv[2]) == 0) {
-        rc = pmd_sim_remove(interface, &ds);
-    } else {
-        rc = -1;
-        ds_put_cstr(&ds, "Invalid usage: ... ops-pmd/sim <interface> [insert <file> | remove]");
+    if (3 == argc && !str_to_uint(argv[2], 10, &n)) {
+        unixctl_command_reply_error(conn, "Invalid sample count");
         return;
     }
 
+    rc = pm_dom_history_dump(&ds, argv[1], n);
+
     if (rc < 0) {
         unixctl_command_reply_error(conn, ds_cstr(&ds));
     } else {
@@ -163,17 +172,31 @@ pmd_unixctl_sim(struct unixctl_conn *conn, int argc,
 
     ds_destroy(&ds);
 }
-#endif
 
 static void
-pmd_unixctl_dump(struct unixctl_conn *conn, int argc OVS_UNUSED,
-                 const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+pmd_unixctl_upper_page(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                       const char *argv[], void *aux OVS_UNUSED)
 {
     struct ds ds = DS_EMPTY_INITIALIZER;
+    unsigned int page;
+    int rc;
 
-    pm_debug_dump(&ds, argc, argv);
+    /* usage:
+        ops-pmd/upper-page <interface> <page>
+    */
+    if (!str_to_uint(argv[2], 16, &page)) {
+        unixctl_command_reply_error(conn, "Invalid page");
+        return;
+    }
+
+    rc = pm_upper_request(&ds, argv[1], page);
+
+    if (rc < 0) {
+        unixctl_command_reply_error(conn, ds_cstr(&ds));
+    } else {
+        unixctl_command_reply(conn, ds_cstr(&ds));
+    }
 
-    unixctl_command_reply(conn, ds_cstr(&ds));
     ds_destroy(&ds);
 }
 
@@ -229,6 +252,15 @@ parse_options(int argc, char *argv[], char **unixctl_pathp)
 {
     enum {
         OPT_UNIXCTL = UCHAR_MAX + 1,
+        OPT_DOM_HISTORY,
+        OPT_DOM_JITTER,
+        OPT_BACKEND,
+        OPT_IO_MODE,
+        OPT_IO_LATENCY,
+        OPT_BUS_BUDGET,
+        OPT_BUS_LOCK_DIR,
+        OPT_OP_DEADLINE,
+        OPT_SNAPSHOT,
         VLOG_OPTION_ENUMS,
         DAEMON_OPTION_ENUMS,
     };
@@ -236,6 +268,15 @@ parse_options(int argc, char *argv[], char **unixctl_pathp)
         {"help",        no_argument, NULL, 'h'},
         {"version",     no_argument, NULL, 'V'},
         {"unixctl",     required_argument, NULL, OPT_UNIXCTL},
+        {"dom-history", required_argument, NULL, OPT_DOM_HISTORY},
+        {"dom-jitter",  required_argument, NULL, OPT_DOM_JITTER},
+        {"backend",     required_argument, NULL, OPT_BACKEND},
+        {"io-mode",     required_argument, NULL, OPT_IO_MODE},
+        {"io-latency",  required_argument, NULL, OPT_IO_LATENCY},
+        {"bus-budget",  required_argument, NULL, OPT_BUS_BUDGET},
+        {"bus-lock-dir", required_argument, NULL, OPT_BUS_LOCK_DIR},
+        {"op-deadline", required_argument, NULL, OPT_OP_DEADLINE},
+        {"snapshot",    required_argument, NULL, OPT_SNAPSHOT},
         DAEMON_LONG_OPTIONS,
         VLOG_LONG_OPTIONS,
         {NULL, 0, NULL, 0},
@@ -262,6 +303,74 @@ parse_options(int argc, char *argv[], char **unixctl_pathp)
             *unixctl_pathp = optarg;
             break;
 
+        case OPT_DOM_HISTORY: {
+            unsigned int size;
+
+            if (!str_to_uint(optarg, 10, &size)
+                || size > PM_DOM_HISTORY_MAX_SIZE) {
+                VLOG_FATAL("--dom-history must be between 0 and %d",
+                           PM_DOM_HISTORY_MAX_SIZE);
+            }
+            pm_dom_history_size = size;
+            break;
+        }
+
+        case OPT_DOM_JITTER:
+            if (!str_to_uint(optarg, 10, &pm_dom_jitter)
+                || pm_dom_jitter > PM_DOM_JITTER_MAX) {
+                VLOG_FATAL("--dom-jitter must be between 0 and %d",
+                           PM_DOM_JITTER_MAX);
+            }
+            break;
+
+        case OPT_BACKEND:
+            if (0 != pm_backend_select(optarg)) {
+                VLOG_FATAL("unknown backend \"%s\"; use --help for a list",
+                           optarg);
+            }
+            break;
+
+        case OPT_IO_MODE:
+            if (0 != pm_io_set_mode(optarg)) {
+                VLOG_FATAL("--io-mode must be uring or serial");
+            }
+            break;
+
+        case OPT_IO_LATENCY:
+            if (!str_to_uint(optarg, 10, &pm_io_latency)
+                || pm_io_latency > PM_IO_LATENCY_MAX) {
+                VLOG_FATAL("--io-latency must be between 0 and %d",
+                           PM_IO_LATENCY_MAX);
+            }
+            break;
+
+        case OPT_BUS_BUDGET:
+            if (!str_to_uint(optarg, 10, &pm_bus_budget)
+                || pm_bus_budget < 1 || pm_bus_budget > 100) {
+                VLOG_FATAL("--bus-budget must be between 1 and 100");
+            }
+            break;
+
+        case OPT_BUS_LOCK_DIR:
+            free(pm_bus_lock_dir);
+            pm_bus_lock_dir = xstrdup(0 == strcmp(optarg, "none") ? ""
+                                                                  : optarg);
+            break;
+
+        case OPT_OP_DEADLINE:
+            if (!str_to_uint(optarg, 10, &pm_bus_deadline)
+                || pm_bus_deadline > PM_BUS_DEADLINE_MAX) {
+                VLOG_FATAL("--op-deadline must be between 0 and %d",
+                           PM_BUS_DEADLINE_MAX);
+            }
+            break;
+
+        case OPT_SNAPSHOT:
+            free(pm_snapshot_file);
+            pm_snapshot_file = xstrdup(0 == strcmp(optarg, "none") ? ""
+                                                                   : optarg);
+            break;
+
         VLOG_OPTION_HANDLERS
         DAEMON_OPTION_HANDLERS
 
@@ -301,9 +410,28 @@ usage(void)
     daemon_usage();
     vlog_usage();
     printf("\nOther options:\n"
+           "  --dom-history=N         keep N DOM samples per port (default: %d)\n"
+           "  --dom-jitter=MSECS      randomly delay each DOM poll by up to MSECS\n"
+           "  --backend=NAME[:ARG]    select the hardware access backend\n"
+           "  --io-mode=uring|serial  how file and sysfs backends batch reads\n"
+           "                          (default: uring)\n"
+           "  --io-latency=USECS      delay each EEPROM file access by USECS\n"
+           "  --bus-budget=PCT        share of bus time for identification and\n"
+           "                          DOM polling (default: %d)\n"
+           "  --bus-lock-dir=DIR      where bus locks shared with other daemons\n"
+           "                          live (default: %s, none to disable)\n"
+           "  --op-deadline=MSECS     deadline of one EEPROM operation before\n"
+           "                          its bus counts as hung (default: %d,\n"
+           "                          0 to disable)\n"
+           "  --snapshot=FILE         where module identities are kept across\n"
+           "                          restarts (default: %s/%s,\n"
+           "                          none to disable)\n"
            "  --unixctl=SOCKET        override default control socket name\n"
            "  -h, --help              display this help message\n"
-           "  -V, --version           display version information\n");
+           "  -V, --version           display version information\n",
+           PM_DOM_HISTORY_DEFAULT_SIZE, PM_BUS_BUDGET_DEFAULT, ovs_rundir(),
+           PM_BUS_DEADLINE_DEFAULT, ovs_rundir(), PM_SNAPSHOT_NAME);
+    pm_backend_usage();
     exit(EXIT_SUCCESS);
 }
 